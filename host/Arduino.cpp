@@ -0,0 +1,135 @@
+/**
+ * @file Arduino.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the Arduino core used by the native build
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <Simulator.h>
+#include <stdarg.h>
+
+HardwareSerial Serial;
+
+unsigned long millis() {return (unsigned long)(Simulator::now / 1000);}
+unsigned long micros() {return (unsigned long)Simulator::now;}
+void delay(unsigned long ms) {Simulator::idle((uint64_t)ms * 1000);}
+void delayMicroseconds(unsigned int us) {Simulator::advance(us);}
+void yield() {}
+
+/**
+ * @brief The clock is set once SNTP is configured and a server answers;
+ *        it stays set
+ */
+static DEVICE_STATE bool configured = false;
+
+void configTime(int timezone, int daylightOffset_sec, const char* server1, const char* server2, const char* server3) {
+    configured = true;
+}
+
+extern "C" time_t time(time_t* timer) noexcept {
+    if (configured && Simulator::sntpUp && Simulator::wifiUp) Simulator::synced = true;
+    time_t now = (Simulator::synced ? Simulator::epoch : 0) + (time_t)(Simulator::now / 1000000);
+    if (timer) *timer = now;
+    return now;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {}
+int digitalRead(uint8_t pin) {return Simulator::input(pin);}
+
+/**
+ * @brief The only analog input on the ESP8266 is the photocell
+ */
+int analogRead(uint8_t pin) {
+    return Simulator::lightTrace ? Simulator::lightTrace(millis()) : Simulator::light;
+}
+
+long random(long max) {return max > 0 ? rand() % max : 0;}
+long random(long min, long max) {return max > min ? min + random(max - min) : min;}
+void randomSeed(unsigned long seed) {srand(seed);}
+
+/**
+ * @brief String conversions
+ */
+static std::string toBase(unsigned long value, unsigned char base, bool negative) {
+    char buf[8 * sizeof(long) + 2];
+    char* p = buf + sizeof(buf) - 1;
+    *p = 0;
+    do {
+        *--p = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+        value /= base;
+    } while (value);
+    if (negative) *--p = '-';
+    return p;
+}
+
+String::String(int value, unsigned char base) :
+    str(toBase(value < 0 && base == 10 ? -(long)value : (unsigned int)value, base, value < 0 && base == 10)) {}
+String::String(unsigned int value, unsigned char base) : str(toBase(value, base, false)) {}
+String::String(long value, unsigned char base) :
+    str(toBase(value < 0 && base == 10 ? -(unsigned long)value : (unsigned long)value, base, value < 0 && base == 10)) {}
+String::String(unsigned long value, unsigned char base) : str(toBase(value, base, false)) {}
+String::String(double value, unsigned char decimals) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    str = buf;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t index = str.find(c, from);
+    return index == std::string::npos ? -1 : (int)index;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > str.size()) return String();
+    if (to > str.size()) to = str.size();
+    return to > from ? String(str.substr(from, to - from)) : String();
+}
+
+void String::toCharArray(char* buf, unsigned int size) const {
+    if (size == 0) return;
+    size_t n = str.size() < size - 1 ? str.size() : size - 1;
+    memcpy(buf, str.data(), n);
+    buf[n] = 0;
+}
+
+String operator+(const String& lhs, const String& rhs) {String s(lhs); s += rhs; return s;}
+String operator+(const String& lhs, const char* rhs) {String s(lhs); s += rhs; return s;}
+String operator+(const char* lhs, const String& rhs) {String s(lhs); s += rhs; return s;}
+
+/**
+ * @brief Print helpers
+ */
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return n > 0 ? write((const uint8_t*)buf, strlen(buf)) : 0;
+}
+
+/**
+ * @brief Each byte costs ten bit times of virtual time, as if the
+ *        UART FIFO were always full
+ */
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (baud) Simulator::advance((uint64_t)size * 10 * 1000000 / baud);
+    if (Simulator::echo) fwrite(buffer, 1, size, stdout);
+    return size;
+}
@@ -0,0 +1,178 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/**
+ * @file Arduino.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the Arduino core used by the native build
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+/**
+ * GPIO
+ */
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A0     17
+
+/**
+ * Flash strings are plain RAM strings on the host
+ */
+#define PROGMEM
+#define PGM_P  const char*
+#define PSTR(s) (s)
+#define memcpy_P memcpy
+#define F(s)    (s)
+
+/**
+ * The globals making up the state of one device live in their own
+ * section, which the fleet simulator swaps from one device to the next
+ */
+#define DEVICE_STATE __attribute__((section("iot3_device")))
+
+/**
+ * Time is virtual: it only moves when the firmware calls delay() or
+ * when the simulator advances it
+ */
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+/**
+ * The wall clock counts from the boot until SNTP sets it; time() is
+ * the one of the C library, replaced by the simulator
+ */
+void configTime(int timezone, int daylightOffset_sec, const char* server1,
+    const char* server2 = nullptr, const char* server3 = nullptr);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief Minimal Arduino String backed by std::string
+ */
+class String {
+    std::string str;
+public:
+    String() {}
+    String(const char* s) : str(s ? s : "") {}
+    String(const std::string& s) : str(s) {}
+    explicit String(char c) : str(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(double value, unsigned char decimals = 2);
+    const char* c_str() const {return str.c_str();}
+    unsigned int length() const {return str.length();}
+    bool isEmpty() const {return str.empty();}
+    bool reserve(unsigned int size) {str.reserve(size); return true;}
+    bool concat(const String& s) {str += s.str; return true;}
+    bool concat(const char* s) {if (s) str += s; return true;}
+    bool concat(char c) {str += c; return true;}
+    bool concat(int value) {return concat(String(value));}
+    bool concat(unsigned int value) {return concat(String(value));}
+    bool concat(long value) {return concat(String(value));}
+    bool concat(unsigned long value) {return concat(String(value));}
+    template <typename T> String& operator+=(const T& rhs) {concat(rhs); return *this;}
+    bool equals(const String& s) const {return str == s.str;}
+    bool equals(const char* s) const {return str == (s ? s : "");}
+    bool operator==(const String& s) const {return equals(s);}
+    bool operator==(const char* s) const {return equals(s);}
+    bool operator!=(const String& s) const {return !equals(s);}
+    bool operator!=(const char* s) const {return !equals(s);}
+    char operator[](unsigned int index) const {return index < str.size() ? str[index] : 0;}
+    char charAt(unsigned int index) const {return (*this)[index];}
+    int indexOf(char c, unsigned int from = 0) const;
+    String substring(unsigned int from, unsigned int to = (unsigned int)-1) const;
+    bool startsWith(const String& prefix) const {return str.compare(0, prefix.str.size(), prefix.str) == 0;}
+    long toInt() const {return strtol(str.c_str(), NULL, 10);}
+    void toCharArray(char* buf, unsigned int size) const;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+
+class Print;
+
+/**
+ * @brief Objects that know how to print themselves (e.g. IPAddress)
+ */
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+/**
+ * @brief Byte sink with the Arduino print helpers
+ */
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) {return str ? write((const uint8_t*)str, strlen(str)) : 0;}
+    size_t print(const char* str) {return write(str);}
+    size_t print(const String& str) {return write(str.c_str());}
+    size_t print(char c) {return write((uint8_t)c);}
+    size_t print(int value) {return print(String(value));}
+    size_t print(unsigned int value) {return print(String(value));}
+    size_t print(long value) {return print(String(value));}
+    size_t print(unsigned long value) {return print(String(value));}
+    size_t print(double value, int decimals = 2) {return print(String(value, decimals));}
+    size_t print(const Printable& value) {return value.printTo(*this);}
+    template <typename T> size_t println(const T& value) {return print(value) + println();}
+    size_t println() {return write("\r\n");}
+    size_t printf(const char* format, ...);
+};
+
+/**
+ * @brief Serial port; writes cost virtual time according to the baud rate
+ */
+class HardwareSerial : public Print {
+    unsigned long baud;
+public:
+    HardwareSerial() : baud(0) {}
+    void begin(unsigned long baud) {this->baud = baud;}
+    void flush() {}
+    int available() {return 0;}
+    int read() {return -1;}
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#include <Esp.h>
+
+#endif
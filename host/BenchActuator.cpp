@@ -0,0 +1,229 @@
+/**
+ * @file BenchActuator.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Ramps of the actuators checked against the waveforms they give
+ *        the generator, where the blinds come to rest against where the
+ *        firmware believes they are, and the CPU cost of a ramp step
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <math.h>
+
+extern Blinds blinds;
+void loop();
+
+#define ACTUATOR_TRIALS 200
+
+/**
+ * Largest gap in % between where the blinds rest and where the firmware
+ * believes they are, or the end after reversals, before the suite fails
+ */
+#define ACTUATOR_BOUND  1
+
+static Motor& motor(uint8_t channel) {return Simulator::motors[Board::servoPin(channel)];}
+
+/**
+ * @brief Runs the loop until every channel stopped and every servo came
+ *        to rest
+ */
+static void rest() {
+    bool moving = true;
+    while (moving) {
+        loop();
+        moving = false;
+        for (uint8_t i = 0; i < CHANNELS; i++) {
+            if (blinds.getState(i) == BS_OPENING || blinds.getState(i) == BS_CLOSING || motor(i).speed) moving = true;
+        }
+    }
+}
+
+/**
+ * @brief Offset of a pulse from the neutral in us; a stopped waveform
+ *        counts as the neutral
+ */
+static double offset(const Pulse& pulse) {
+    return pulse.high ? (double)pulse.high - ACTUATOR_NEUTRAL : 0;
+}
+
+/**
+ * @brief Accuracy of the steps of a ramp
+ */
+struct Ramps {
+    Samples width;
+    Samples distance;
+    Samples jitter;
+    Samples duration;
+};
+
+/**
+ * @brief Checks the ramp the recorded pulses from first to last make
+ *        against the straight one of the given length: the width of
+ *        each step against the straight ramp in the middle of the step,
+ *        the distance run over the ramp and the spacing of the steps
+ *
+ * @param pulses of one pin
+ * @param first step of the ramp
+ * @param last step, at the target speed
+ * @param length of the ramp from standstill to full speed, in ms
+ * @param ramps
+ */
+static void check(const std::vector<Pulse>& pulses, size_t first, size_t last, unsigned long length, Ramps& ramps) {
+    double from = offset(pulses[first - 1]);
+    double to = offset(pulses[last]);
+    double start = pulses[first].at / 1000.0;
+    double span = fabs(to - from) * length / ACTUATOR_SPAN;
+    double slope = (to - from) / span;
+    double staircase = 0, straight = (from + to) / 2 * span;
+    for (size_t k = first; k < last; k++) {
+        double at = pulses[k].at / 1000.0, next = pulses[k + 1].at / 1000.0;
+        double middle = (at + next) / 2 - start;
+        ramps.width.add(fabs(offset(pulses[k]) - (from + slope * middle)));
+        ramps.jitter.add(fabs(next - at - ACTUATOR_STEP));
+        staircase += offset(pulses[k]) * (next - at);
+    }
+    staircase += to * (start + span - pulses[last].at / 1000.0);
+    ramps.distance.add(fabs(staircase - straight) / ACTUATOR_SPAN);
+    ramps.duration.add(pulses[last].at / 1000.0 - start);
+}
+
+/**
+ * @brief Every channel opens from closed and is stopped at a random
+ *        time; the ramps of the first channel are checked from the
+ *        waveforms, then the blinds are left to rest and their position
+ *        compared with the one the firmware reports
+ */
+static void stops(Ramps& accelerations, Ramps& decelerations, Samples& error, Samples& updates, unsigned long& settled) {
+    std::vector<Pulse> pulses;
+    for (int trial = 0; trial < ACTUATOR_TRIALS; trial++) {
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}");
+        loopFor(100);
+        rest();
+        Simulator::waveform.clear();
+        Simulator::recording = true;
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"open\"}", random(ACTUATOR_STEP * 1000));
+        loopFor(100);
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"stop\"}", (400 + random(1200)) * 1000ULL);
+        loopFor(100);
+        rest();
+        Simulator::recording = false;
+
+        pulses.clear();
+        for (size_t i = 0; i < Simulator::waveform.size(); i++) {
+            if (Simulator::waveform[i].pin == Board::servoPin(0)) pulses.push_back(Simulator::waveform[i]);
+        }
+        updates.add(pulses.size());
+        error.add(fabs(motor(0).position * 100 - blinds.getPosition(0)));
+        const Pulse& last = pulses.back();
+        if (ACTUATOR_HOLD ? last.high == ACTUATOR_NEUTRAL : !last.high && !last.low) settled++;
+
+        /**
+         * Up to full speed from the neutral the servo starts from, down
+         * from full speed to the neutral or the stopped waveform
+         */
+        size_t full = 0;
+        while (full < pulses.size() && offset(pulses[full]) < ACTUATOR_SPAN) full++;
+        size_t stopped = full + 1;
+        while (stopped < pulses.size() && offset(pulses[stopped])) stopped++;
+        if (stopped >= pulses.size()) continue;
+        pulses.insert(pulses.begin(), Pulse{pulses[0].at, pulses[0].pin, ACTUATOR_NEUTRAL, ACTUATOR_FRAME - ACTUATOR_NEUTRAL});
+        check(pulses, 1, full + 1, ACTUATOR_ACCELERATION, accelerations);
+        check(pulses, full + 2, stopped + 1, ACTUATOR_DECELERATION, decelerations);
+    }
+}
+
+/**
+ * @brief The first channel is sent to random positions, then back to
+ *        closed, in the middle of the previous travel or while it still
+ *        coasts
+ */
+static void positions(Samples& error, Samples& closed) {
+    for (int trial = 0; trial < ACTUATOR_TRIALS; trial++) {
+        char command[48];
+        snprintf(command, sizeof(command), "{\"cmd\":\"set_position\",\"position\":%ld}", random(101));
+        Simulator::inject(SIM_OBJECT_COMMANDS, command);
+        loopFor(100);
+        rest();
+        error.add(fabs(motor(0).position * 100 - blinds.getPosition(0)));
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}");
+        loopFor(random(2500));
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"open\"}");
+        loopFor(random(300));
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}");
+        loopFor(100);
+        rest();
+        closed.add(motor(0).position * 100);
+    }
+}
+
+/**
+ * @brief Cost of Actuator::update() on a ramp step and at a steady
+ *        speed, on actuators without a pin
+ */
+static void cpu() {
+    static Actuator actuators[1000];
+    Samples step, steady;
+    for (int i = 0; i < 1000; i++) actuators[i].drive(ACTUATOR_FULL);
+    for (int round = 0; round < 20; round++) {
+        loopFor(ACTUATOR_STEP);
+        Stopwatch watch;
+        for (int i = 0; i < 1000; i++) actuators[i].update();
+        (round < ACTUATOR_ACCELERATION / ACTUATOR_STEP ? step : steady).add(watch.elapsedUs());
+    }
+    step.report("Actuator::update() cpu on a ramp step", "ns");
+    steady.report("Actuator::update() cpu at a steady speed", "ns");
+}
+
+/**
+ * @brief Ramps, positions and hold, on every channel moving at once so
+ *        that the steps of the ramps share the scheduler timer with the
+ *        other travels. The blinds run without end stops at the travel
+ *        the firmware assumes, whatever the suites before left, and get
+ *        it back at the end
+ */
+void benchActuator() {
+    bool endStops = Simulator::endStops;
+    Motor motors[CHANNELS];
+    uint16_t travels[CHANNELS][2];
+    Simulator::endStops = false;
+    for (uint8_t c = 0; c < CHANNELS; c++) {
+        motors[c] = motor(c);
+        travels[c][0] = blinds.getTravel(c, BS_OPENING);
+        travels[c][1] = blinds.getTravel(c, BS_CLOSING);
+        motor(c).opening = motor(c).closing = SIM_TRAVEL;
+        blinds.setTravel(c, Board::travel, Board::travel);
+    }
+    manual();
+    Ramps accelerations, decelerations;
+    Samples error, updates, positioning, closed;
+    unsigned long settled = 0;
+    stops(accelerations, decelerations, error, updates, settled);
+    accelerations.width.report("acceleration step vs straight ramp", "us");
+    accelerations.distance.report("acceleration distance error", "ms");
+    accelerations.jitter.report("acceleration step jitter", "ms");
+    accelerations.duration.report("acceleration first to last step", "ms");
+    decelerations.width.report("deceleration step vs straight ramp", "us");
+    decelerations.distance.report("deceleration distance error", "ms");
+    decelerations.jitter.report("deceleration step jitter", "ms");
+    decelerations.duration.report("deceleration first to last step", "ms");
+    updates.report("waveform updates per travel", "pulses");
+    error.report("stop at random: rest vs reported", "%");
+    printf("servo %s after %lu/%d stops\n", ACTUATOR_HOLD ? "held at the neutral" : "released", settled, ACTUATOR_TRIALS);
+    positions(positioning, closed);
+    positioning.report("set_position: rest vs reported", "%");
+    closed.report("close after reversals: rest from the end", "%");
+    expect(error.percentile(100) <= ACTUATOR_BOUND, "stop at random within ACTUATOR_BOUND of the reported position");
+    expect(positioning.percentile(100) <= ACTUATOR_BOUND, "set_position within ACTUATOR_BOUND of the reported position");
+    expect(closed.percentile(100) <= ACTUATOR_BOUND, "close after reversals within ACTUATOR_BOUND of the end");
+    cpu();
+    Simulator::endStops = endStops;
+    for (uint8_t c = 0; c < CHANNELS; c++) {
+        motor(c).opening = motors[c].opening;
+        motor(c).closing = motors[c].closing;
+        blinds.setTravel(c, travels[c][0], travels[c][1]);
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ * @file BenchChannels.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Every channel of a device commanded at once
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+extern Blinds blinds;
+void loop();
+
+static unsigned long messages;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retain) {
+    if (!strcmp(topic, SIM_OBJECT_STATES)) messages++;
+}
+
+/**
+ * @brief Sends each channel its own set_position on its subtopic in the
+ *        same instant, then checks where every channel ended and counts
+ *        the state messages; a device per window would send two per
+ *        channel
+ */
+void benchChannels() {
+    Samples perRound, cpu, error;
+    unsigned long moving = 0;
+    manual();
+    loopFor(100);
+    Simulator::onPublish = onPublish;
+    for (int i = 0; i < 500; i++) {
+        int targets[CHANNELS];
+        for (uint8_t c = 0; c < CHANNELS; c++) {
+            char topic[MAX_TOPIC], command[64];
+            targets[c] = random(101);
+            snprintf(topic, sizeof(topic), SIM_OBJECT_COMMANDS "/%u", c);
+            snprintf(command, sizeof(command), "{\"cmd\":\"set_position\",\"position\":%d}", targets[c]);
+            Simulator::inject(topic, command);
+        }
+        messages = 0;
+        unsigned long start = millis();
+        while (millis() - start < 2500) {
+            Stopwatch watch;
+            loop();
+            cpu.add(watch.elapsedUs());
+        }
+        perRound.add(messages);
+        for (uint8_t c = 0; c < CHANNELS; c++) {
+            if (blinds.getState(c) == BS_OPENING || blinds.getState(c) == BS_CLOSING) moving++;
+            error.add(abs(blinds.getPosition(c) - targets[c]));
+        }
+    }
+    Simulator::onPublish = NULL;
+    printf("channels=%d (a device per channel: up to %d messages per round)\n", CHANNELS, 2 * CHANNELS);
+    perRound.report("state messages per round", "msgs");
+    error.report("position error", "%");
+    cpu.report("loop() cpu", "us");
+    printf("still moving=%lu\n", moving);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file BenchFormat.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief JSON against MessagePack on the wire
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <ArduinoJson.h>
+
+extern Blinds blinds;
+void loop();
+
+#define FORMAT_ROUNDS 10000
+
+/**
+ * Commands as a controller sends them
+ */
+static const char* commands[] = {
+    "{\"cmd\":\"open\"}",
+    "{\"cmd\":\"close\"}",
+    "{\"cmd\":\"set_mode\",\"mode\":1}",
+    "{\"cmd\":\"set_position\",\"position\":40}",
+    "{\"cmd\":\"query_objects\",\"window\":2000}",
+};
+
+static std::string lastState;
+static uint64_t publishedAt;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retain) {
+    if (strcmp(topic, SIM_OBJECT_STATES)) return;
+    lastState.assign((const char*)payload, length);
+    publishedAt = Simulator::now;
+}
+
+/**
+ * @brief Encodes a command the way a controller would for a device
+ *        speaking the given format
+ */
+static std::string encode(const char* command, bool msgpack) {
+    if (!msgpack) return command;
+    StaticJsonDocument<256> doc;
+    uint8_t buffer[128];
+    deserializeJson(doc, command);
+    size_t length = serializeMsgPack(doc, buffer, sizeof(buffer));
+    return std::string((const char*)buffer, length);
+}
+
+static void send(const std::string& command) {
+    Simulator::inject(SIM_OBJECT_COMMANDS, (const uint8_t*)command.data(), command.size());
+}
+
+/**
+ * @brief Bytes and host CPU time of one format: command parsing the way
+ *        the MQTT callback does it, state serializing the way the state
+ *        message is built, then the whole path through the firmware
+ */
+static void measure(bool msgpack) {
+    const char* name = msgpack ? "msgpack" : "json";
+    StaticJsonDocument<JSON_OBJECT_SIZE(5)> filter;
+    filter["cmd"] = true;
+    filter["mode"] = true;
+    filter["position"] = true;
+    filter["window"] = true;
+    filter["format"] = true;
+
+    double commandBytes = 0, parse = 0;
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        std::string command = encode(commands[i], msgpack);
+        commandBytes += command.size();
+        Stopwatch watch;
+        for (int k = 0; k < FORMAT_ROUNDS; k++) {
+            StaticJsonDocument<JSON_OBJECT_SIZE(5)> doc;
+            std::string copy = command;
+            if (msgpack) deserializeMsgPack(doc, (uint8_t*)&copy[0], copy.size(), DeserializationOption::Filter(filter));
+            else deserializeJson(doc, (uint8_t*)&copy[0], copy.size(), DeserializationOption::Filter(filter));
+        }
+        parse += watch.elapsedUs() / FORMAT_ROUNDS;
+    }
+    size_t count = sizeof(commands) / sizeof(commands[0]);
+
+    /**
+     * State message of the simulated device
+     */
+    StaticJsonDocument<256> state;
+    char buffer[MAX_MESSAGE];
+    deserializeJson(state, "{\"ip\":\"192.168.0.100\",\"name\":\"" DEF_NAME "\",\"format\":\"json\","
+        "\"objects\":{\"state\":\"opened\",\"mode\":\"manual\",\"position\":100}}");
+    Stopwatch watch;
+    for (int k = 0; k < FORMAT_ROUNDS; k++) {
+        if (msgpack) serializeMsgPack(state, buffer, sizeof(buffer));
+        else serializeJson(state, buffer, sizeof(buffer));
+    }
+    double serialize = watch.elapsedUs() / FORMAT_ROUNDS;
+
+    /**
+     * Whole path: command in, state out
+     */
+    Samples cpu;
+    double stateBytes = 0;
+    for (int i = 0; i < 500; i++) {
+        send(encode(blinds.getState(0) == BS_CLOSED ? commands[0] : commands[1], msgpack));
+        uint64_t published = publishedAt;
+        while (publishedAt == published) {
+            Stopwatch pass;
+            loop();
+            if (publishedAt != published) cpu.add(pass.elapsedUs());
+        }
+        stateBytes += lastState.size();
+        loopFor(2500);
+    }
+    printf("%-8s command %5.1f bytes, parse %6.3f us | state %5.1f bytes, serialize %6.3f us\n",
+        name, commandBytes / count, parse / count, stateBytes / 500, serialize);
+    char label[64];
+    snprintf(label, sizeof(label), "%s command-to-publish cpu", name);
+    cpu.report(label, "us");
+}
+
+/**
+ * @brief Compares both formats, switching the simulated device with
+ *        set_format; the switch back is sent in MessagePack
+ */
+void benchFormat() {
+    manual();
+    loopFor(100);
+    Simulator::onPublish = onPublish;
+    measure(false);
+    send(encode("{\"cmd\":\"set_format\",\"format\":\"msgpack\"}", false));
+    loopFor(100);
+    if ((uint8_t)lastState[0] >> 4 != 0x8) printf("state not switched to msgpack\n");
+    measure(true);
+    send(encode("{\"cmd\":\"set_format\",\"format\":\"json\"}", true));
+    loopFor(100);
+    if (lastState[0] != '{') printf("state not switched back to json\n");
+    Simulator::onPublish = NULL;
+}
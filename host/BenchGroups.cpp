@@ -0,0 +1,234 @@
+/**
+ * @file BenchGroups.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Groups joined and left over MQTT, their subscriptions across a
+ *        reconnection, commands on a group topic against one message
+ *        per channel, and their CPU cost
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <algorithm>
+#include <string>
+
+extern Blinds blinds;
+extern CommandQueue commandQueue;
+void loop();
+
+#define SIM_GROUPS "/IOT3/GROUPS/"
+#define GROUP_TRIALS 200
+
+/**
+ * Pace of a controller sending one message per channel, in ms
+ */
+#define CONTROLLER_GAP 10
+
+static std::vector<std::string> filters;
+
+static Motor& motor(uint8_t channel) {return Simulator::motors[Board::servoPin(channel)];}
+
+static void onSubscribe(const char* filter) {
+    if (filter) filters.push_back(filter);
+    else filters.clear();
+}
+
+static std::string channelTopic(uint8_t channel) {
+    return SIM_OBJECT_COMMANDS "/" + std::to_string(channel);
+}
+
+static void join(const std::string& topic, const char* group, bool leave = false) {
+    std::string command = std::string("{\"cmd\":\"") + (leave ? "leave" : "join") + "\",\"group\":\"" + group + "\"}";
+    Simulator::inject(topic.c_str(), command.c_str());
+    loopFor(50);
+}
+
+static bool subscribed(const char* group) {
+    return std::count(filters.begin(), filters.end(), std::string(SIM_GROUPS) + group) == 1;
+}
+
+/**
+ * @brief Which groups the channels are in once saved
+ */
+static uint8_t members(const GroupSettings& settings, const char* group) {
+    for (uint8_t i = 0; i < MAX_GROUPS; i++) {
+        if (!strcmp(settings.groups[i].name, group)) return settings.groups[i].channels;
+    }
+    return 0;
+}
+
+/**
+ * @brief Channels 0 and 2 join the living room, the device the house,
+ *        channel 3 the hall and channel 1 the porch; a fifth group and
+ *        invalid names are refused until the hall is left, and a join
+ *        dropped by a full queue is forgotten. The groups are subscribed
+ *        once, and again after the broker comes back
+ */
+static void membership() {
+    join(channelTopic(0), "living");
+    join(channelTopic(2), "living");
+    join(SIM_OBJECT_COMMANDS, "house");
+    join(channelTopic(3), "hall");
+    join(channelTopic(1), "porch");
+    join(channelTopic(0), "attic");
+    join(channelTopic(0), "a/b");
+    join(channelTopic(0), "");
+    join(channelTopic(0), "abcdefghijklmnop");
+    GroupSettings full;
+    bool refused = Repository::loadGroups(full) && !members(full, "attic") && !members(full, "a/b") &&
+        !members(full, "abcdefghijklmnop");
+    join(channelTopic(3), "hall", true);
+    join(channelTopic(0), "attic");
+    bool subscriptions = subscribed("living") && subscribed("house") && subscribed("porch") && subscribed("attic");
+    join(channelTopic(0), "attic", true);
+    unsigned long dropped = commandQueue.getDropped();
+    saturate();
+    join(channelTopic(0), "attic");
+    bool forgotten = commandQueue.getDropped() == dropped + 1;
+    join(channelTopic(1), "porch");
+
+    Simulator::brokerUp = false;
+    loopFor(5000);
+    filters.clear();
+    Simulator::brokerUp = true;
+    unsigned long start = millis();
+    while (!subscribed("porch") && millis() - start < 60000) loop();
+    bool restored = subscribed("living") && subscribed("house") && subscribed("porch") && !subscribed("attic") &&
+        !subscribed("hall");
+
+    GroupSettings saved;
+    bool valid = Repository::loadGroups(saved) && members(saved, "living") == 0x5 &&
+        members(saved, "house") == CHANNEL_MASK && members(saved, "porch") == 0x2 && !members(saved, "hall") &&
+        !members(saved, "attic");
+    printf("groups: %u bytes saved, fifth group and invalid names %s, subscriptions %s, after a reconnection %s, %s\n",
+        (unsigned)sizeof(saved), refused ? "refused" : "ACCEPTED", subscriptions ? "valid" : "INVALID",
+        restored ? "restored" : "LOST", valid ? "valid" : "INVALID");
+    expect(forgotten && restored && valid, "groups saved and subscribed as sent, without the join dropped");
+}
+
+/**
+ * @brief Positions sent to the living room reach channels 0 and 2
+ *        only; commands other than motion and mode are ignored on a
+ *        group topic
+ */
+static void dispatch(Samples& error, unsigned long& strays) {
+    for (int trial = 0; trial < GROUP_TRIALS; trial++) {
+        uint8_t before[CHANNELS];
+        for (uint8_t c = 0; c < CHANNELS; c++) before[c] = blinds.getPosition(c);
+        int target = random(101);
+        char command[48];
+        snprintf(command, sizeof(command), "{\"cmd\":\"set_position\",\"position\":%d}", target);
+        Simulator::inject(SIM_GROUPS "living", command);
+        loopFor(3000);
+        for (uint8_t c = 0; c < CHANNELS; c++) {
+            if (c == 0 || c == 2) error.add(abs(blinds.getPosition(c) - target));
+            else if (blinds.getPosition(c) != before[c]) strays++;
+        }
+    }
+    Simulator::inject(SIM_GROUPS "living", "{\"cmd\":\"set_format\",\"format\":\"msgpack\"}");
+    Simulator::inject(SIM_GROUPS "living", "{\"cmd\":\"join\",\"group\":\"den\"}");
+    loopFor(100);
+    GroupSettings saved;
+    Repository::loadGroups(saved);
+    bool ignored = Repository::cached().getFormat() == WF_JSON && !members(saved, "den");
+    printf("configuration on a group topic %s\n", ignored ? "ignored" : "APPLIED");
+}
+
+/**
+ * @brief Start of the first channel to move to the last, when every
+ *        channel is opened with its own message at the pace of a
+ *        controller, or with one message to a group
+ */
+static void spread(bool grouped, Samples& samples) {
+    for (int trial = 0; trial < GROUP_TRIALS; trial++) {
+        Simulator::inject(SIM_GROUPS "house", "{\"cmd\":\"close\"}");
+        loopFor(2500);
+        uint64_t offset = random(CONTROLLER_GAP * 1000);
+        for (uint8_t c = 0; c < (grouped ? 1 : CHANNELS); c++) {
+            std::string topic = grouped ? SIM_GROUPS "house" : channelTopic(c);
+            Simulator::inject(topic.c_str(), "{\"cmd\":\"open\"}", offset + c * CONTROLLER_GAP * 1000ULL);
+        }
+        uint64_t first = 0, last = 0;
+        uint8_t moving = 0;
+        bool seen[CHANNELS] = {false};
+        unsigned long start = millis();
+        while (moving < CHANNELS && millis() - start < 1000) {
+            loop();
+            for (uint8_t c = 0; c < CHANNELS; c++) {
+                if (seen[c] || blinds.getState(c) != BS_OPENING) continue;
+                seen[c] = true;
+                if (!moving++) first = Simulator::now;
+                last = Simulator::now;
+            }
+        }
+        samples.add((last - first) / 1000.0);
+        loopFor(2500);
+    }
+}
+
+/**
+ * @brief Cost of the loop pass that takes a stop of an idle channel,
+ *        on the object topic and on the topic of a group
+ */
+static void cpu(const char* topic, const char* name) {
+    Samples samples;
+    for (int i = 0; i < 1000; i++) {
+        Simulator::inject(topic, "{\"cmd\":\"stop\"}");
+        Stopwatch watch;
+        loop();
+        samples.add(watch.elapsedUs());
+        loopFor(20);
+    }
+    samples.report(name, "us");
+}
+
+/**
+ * @brief Membership, dispatch and spread on the channels of one device,
+ *        then every group is left for the suites that follow. The blinds
+ *        run without end stops at the travel the firmware assumes,
+ *        whatever the suites before left, and get it back at the end
+ */
+void benchGroups() {
+    bool endStops = Simulator::endStops;
+    Motor motors[CHANNELS];
+    uint16_t travels[CHANNELS][2];
+    Simulator::endStops = false;
+    for (uint8_t c = 0; c < CHANNELS; c++) {
+        motors[c] = motor(c);
+        travels[c][0] = blinds.getTravel(c, BS_OPENING);
+        travels[c][1] = blinds.getTravel(c, BS_CLOSING);
+        motor(c).opening = motor(c).closing = SIM_TRAVEL;
+        blinds.setTravel(c, Board::travel, Board::travel);
+    }
+    manual();
+    loopFor(100);
+    filters.clear();
+    Simulator::onSubscribe = onSubscribe;
+    membership();
+    Samples error, perChannel, perGroup;
+    unsigned long strays = 0;
+    dispatch(error, strays);
+    error.report("group set_position: member error", "%");
+    printf("non-members moved: %lu/%d\n", strays, GROUP_TRIALS * (CHANNELS - 2));
+    spread(false, perChannel);
+    spread(true, perGroup);
+    printf("messages to open %d channels: %d one per channel, 1 on a group\n", CHANNELS, CHANNELS);
+    perChannel.report("start spread, one message per channel", "ms");
+    perGroup.report("start spread, one message per group", "ms");
+    cpu(SIM_OBJECT_COMMANDS, "stop on the object topic cpu");
+    cpu(SIM_GROUPS "porch", "stop on a group topic cpu");
+    join(SIM_OBJECT_COMMANDS, "living", true);
+    join(SIM_OBJECT_COMMANDS, "house", true);
+    join(SIM_OBJECT_COMMANDS, "porch", true);
+    Simulator::onSubscribe = NULL;
+    manual();
+    Simulator::endStops = endStops;
+    for (uint8_t c = 0; c < CHANNELS; c++) {
+        motor(c).opening = motors[c].opening;
+        motor(c).closing = motors[c].closing;
+        blinds.setTravel(c, travels[c][0], travels[c][1]);
+    }
+}
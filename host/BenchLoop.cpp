@@ -0,0 +1,231 @@
+/**
+ * @file BenchLoop.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Hot path benchmarks: main loop, transitions and MQTT commands
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <math.h>
+
+extern Blinds blinds;
+void loop();
+
+/**
+ * @brief Host CPU time of one main loop iteration and virtual time
+ *        between iterations (the loop period seen by the device)
+ */
+void benchLoop() {
+    Samples cpu, period;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t before = Simulator::now;
+        Stopwatch watch;
+        loop();
+        cpu.add(watch.elapsedUs());
+        period.add((Simulator::now - before) / 1000.0);
+    }
+    cpu.report("BlindsStub::loop() cpu", "us");
+    period.report("BlindsStub::loop() period", "ms");
+}
+
+/**
+ * @brief Host CPU time of each transition including the observer
+ *        publish it triggers
+ */
+void benchSetState() {
+    static const BlindsEvent events[] = {BE_OPEN, BE_TIMEOUT, BE_CLOSE, BE_TIMEOUT};
+    Samples cpu;
+    manual();
+    for (int i = 0; i < 10000; i++) {
+        for (size_t j = 0; j < sizeof(events) / sizeof(events[0]); j++) {
+            Stopwatch watch;
+            blinds.setState(0, events[j]);
+            cpu.add(watch.elapsedUs());
+        }
+    }
+    cpu.report("Blinds::setState() cpu", "us");
+
+    /**
+     * Daylight in manual mode: dispatch and trace only
+     */
+    Samples ignored;
+    for (int i = 0; i < 100; i++) {
+        Stopwatch watch;
+        for (int j = 0; j < 10000; j++) blinds.setState(j % CHANNELS, BE_DAYTIME);
+        ignored.add(watch.elapsedUs() * 1000 / 10000);
+    }
+    ignored.report("Blinds::setState() ignored event cpu", "ns");
+}
+
+static uint64_t publishedAt;
+
+static unsigned long states;
+
+/**
+ * @brief Counts the state messages only; the diagnostics go out in
+ *        between
+ */
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (strcmp(topic, SIM_OBJECT_STATES)) return;
+    publishedAt = Simulator::now;
+    states++;
+}
+
+/**
+ * @brief Latency from the arrival of an open/close command at a random
+ *        instant to the resulting state publish, in virtual time, host
+ *        CPU time of the loop iteration that handled it and the travel
+ *        time actually applied to the servo
+ */
+void benchCallback() {
+    Samples latency, cpu, travel;
+    manual();
+    loopFor(100);
+    Simulator::onPublish = onPublish;
+    for (int i = 0; i < 1000; i++) {
+        const char* command = blinds.getState(0) == BS_CLOSED ? "{\"cmd\":\"open\"}" : "{\"cmd\":\"close\"}";
+        uint64_t arrival = Simulator::now + random(100000);
+        Simulator::inject(SIM_OBJECT_COMMANDS, command, arrival - Simulator::now);
+        unsigned long published = states;
+        while (states == published) {
+            Stopwatch watch;
+            loop();
+            if (states != published) cpu.add(watch.elapsedUs());
+        }
+        latency.add((publishedAt - arrival) / 1000.0);
+
+        /**
+         * Let the travel complete before the next command
+         */
+        uint64_t started = publishedAt;
+        published = states;
+        while (states == published && Simulator::now - started < 10000000ULL) loop();
+        travel.add((publishedAt - started) / 1000.0);
+    }
+    Simulator::onPublish = NULL;
+    latency.report("command-to-publish latency", "ms");
+    cpu.report("command-to-publish cpu", "us");
+    travel.report("travel time", "ms");
+}
+
+static std::string lastState;
+
+static void onStatePublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (strcmp(topic, SIM_OBJECT_STATES)) return;
+    publishedAt = Simulator::now;
+    lastState.assign((const char*)payload, length);
+}
+
+/**
+ * @brief Runs the loop until a state containing the given text is
+ *        published
+ */
+static bool loopUntilState(const char* text, unsigned long timeout) {
+    unsigned long start = millis();
+    do {
+        if (!loopUntilPublished(1, timeout)) return false;
+    } while (lastState.find(text) == std::string::npos && millis() - start < timeout);
+    return lastState.find(text) != std::string::npos;
+}
+
+/**
+ * @brief Latency from a close command arriving at a random instant of
+ *        an opening travel to the reversal, the travel back measured
+ *        against the time spent opening, and set_position accuracy
+ */
+void benchReverse() {
+    Samples latency, error, positioning;
+    unsigned long failures = 0;
+    manual();
+    Simulator::onPublish = onStatePublish;
+    if (blinds.getState(0) != BS_CLOSED) {
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}");
+        loopUntilState("\"closed\"", 10000);
+    }
+    for (int i = 0; i < 1000; i++) {
+
+        /**
+         * Past the publisher window, so that the opening is published
+         * as soon as it starts
+         */
+        loopFor(100);
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"open\"}");
+        if (!loopUntilState("\"opening\"", 1000)) failures++;
+        uint64_t opening = publishedAt;
+        uint64_t arrival = Simulator::now + (100 + random(1800)) * 1000;
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}", arrival - Simulator::now);
+        if (!loopUntilState("\"closing\"", 3000)) failures++;
+        latency.add((publishedAt - arrival) / 1000.0);
+        uint64_t closing = publishedAt;
+        if (!loopUntilState("\"closed\"", 3000)) failures++;
+        error.add(fabs((double)(publishedAt - closing) - (double)(closing - opening)) / 1000.0);
+
+        int percent = random(101);
+        char command[48];
+        snprintf(command, sizeof(command), "{\"cmd\":\"set_position\",\"position\":%d}", percent);
+        Simulator::inject(SIM_OBJECT_COMMANDS, command);
+        if (percent && !loopUntilState("\"opened\"", 3000)) failures++;
+        positioning.add(abs(blinds.getPosition(0) - percent));
+        Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}");
+        if (percent && !loopUntilState("\"closed\"", 3000)) failures++;
+    }
+    Simulator::onPublish = NULL;
+    latency.report("close-while-opening reaction latency", "ms");
+    error.report("travel back vs travel out", "ms");
+    positioning.report("set_position error", "%");
+    printf("failures=%lu\n", failures);
+}
+
+extern CommandQueue commandQueue;
+
+/**
+ * @brief Bursts of motion commands from a home controller, all arriving
+ *        at once: publishes each burst causes, queue counters, and
+ *        whether the blinds end where the last command asked
+ */
+void benchStorm() {
+    static const char* motions[] = {
+        "{\"cmd\":\"open\"}", "{\"cmd\":\"close\"}", "{\"cmd\":\"stop\"}",
+        "{\"cmd\":\"set_position\",\"position\":25}", "{\"cmd\":\"set_position\",\"position\":75}",
+        "{\"cmd\":\"set_mode\",\"mode\":1}"
+    };
+    static const int outcomes[] = {100, 0, -1, 25, 75, -1};
+    Samples publishes, cpu;
+    unsigned long mismatches = 0;
+    unsigned long coalesced = commandQueue.getCoalesced();
+    unsigned long dropped = commandQueue.getDropped();
+    manual();
+    Simulator::onPublish = onStatePublish;
+    for (int i = 0; i < 1000; i++) {
+        int burst = 2 + random(MAX_COMMANDS * 2);
+        int outcome = -1;
+        for (int j = 0; j < burst; j++) {
+            int k = random(sizeof(motions) / sizeof(motions[0]));
+            Simulator::inject(SIM_OBJECT_COMMANDS, motions[k]);
+            if (outcomes[k] >= 0 || k == 2) outcome = outcomes[k];
+        }
+        unsigned long published = Simulator::published;
+        while (!Simulator::inbox.empty()) {
+            Stopwatch watch;
+            loop();
+            cpu.add(watch.elapsedUs());
+        }
+
+        /**
+         * Let the travel complete
+         */
+        loopFor(2500);
+        publishes.add(Simulator::published - published);
+        if (outcome >= 0 && abs(blinds.getPosition(0) - outcome) > 1) mismatches++;
+    }
+    Simulator::onPublish = NULL;
+    publishes.report("publishes per burst", "msgs");
+    cpu.report("loop() cpu while draining a burst", "us");
+    printf("coalesced=%lu dropped=%lu high_water=%u mismatches=%lu\n",
+        commandQueue.getCoalesced() - coalesced, commandQueue.getDropped() - dropped,
+        commandQueue.getHighWater(), mismatches);
+}
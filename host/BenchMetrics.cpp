@@ -0,0 +1,79 @@
+/**
+ * @file BenchMetrics.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Cost of the runtime metrics and what they publish and serve
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <ArduinoJson.h>
+
+void loop();
+
+#if METRICS
+#define SIM_OBJECT_DIAGNOSTICS "/IOT3/DIAGNOSTICS/192.168.0.100"
+
+static unsigned long diagnostics;
+static std::string last;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (strcmp(topic, SIM_OBJECT_DIAGNOSTICS)) return;
+    diagnostics++;
+    last.assign((const char*)payload, length);
+}
+
+/**
+ * @brief Body of a GET on the portal server, empty if the status is
+ *        not 200
+ */
+static std::string get(const char* uri) {
+    std::shared_ptr<Socket> socket = Simulator::connect();
+    socket->in = std::string("GET ") + uri + " HTTP/1.1\r\nHost: 192.168.0.100\r\n\r\n";
+    std::string response;
+    for (int i = 0; i < 1000 && !socket->closed; i++) {
+        loop();
+        response += socket->out;
+        socket->out.clear();
+    }
+    if (response.compare(0, 12, "HTTP/1.1 200")) return "";
+    size_t body = response.find("\r\n\r\n");
+    return body == std::string::npos ? "" : response.substr(body + 4);
+}
+#endif
+
+/**
+ * @brief Host CPU time of a timed scope, then the diagnostics published
+ *        over two periods and served at /metrics
+ */
+void benchMetrics() {
+#if METRICS
+    Samples cpu;
+    for (int i = 0; i < 100; i++) {
+        Stopwatch watch;
+        for (int j = 0; j < 10000; j++) {
+            METRIC_TIME(MT_BLINDS);
+        }
+        cpu.add(watch.elapsedUs() * 1000 / 10000);
+    }
+    cpu.report("timed scope cpu", "ns");
+
+    Simulator::onPublish = onPublish;
+    diagnostics = 0;
+    loopFor(120000);
+    StaticJsonDocument<1024> doc;
+    bool valid = !deserializeJson(doc, last) && doc["loop"]["n"].as<unsigned long>() > 0;
+    printf("diagnostics: %lu messages in 120 s, %zu bytes of %d, %s\n",
+        diagnostics, last.size(), MAX_DIAGNOSTICS, valid ? "valid" : "INVALID");
+
+    std::string body = get("/metrics");
+    valid = !body.empty() && !deserializeJson(doc, body) && doc.containsKey("heap");
+    printf("/metrics: %zu bytes, %s\n", body.size(), valid ? "valid" : "INVALID");
+    Simulator::onPublish = NULL;
+#else
+    printf("metrics compiled out\n");
+#endif
+}
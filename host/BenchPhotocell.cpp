@@ -0,0 +1,202 @@
+/**
+ * @file BenchPhotocell.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Servo runs per day in automatic mode under noisy light, with
+ *        the raw threshold of the first firmware and with the filter
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <math.h>
+
+extern Blinds blinds;
+extern CommandQueue commandQueue;
+void loop();
+
+#define DAY  86400000UL
+#define HOUR 3600000UL
+
+/**
+ * The rule of the first firmware: one reading against one threshold on
+ * every sample
+ */
+#define RAW_THRESHOLD 150
+#define RAW_PERIOD    250
+
+/**
+ * @brief ADC noise, uniform
+ */
+static int noise(int amplitude) {
+    return rand() % (2 * amplitude + 1) - amplitude;
+}
+
+/**
+ * @brief Sun up from 6:00 to 7:00, down from 19:00 to 20:00
+ */
+static double sun(unsigned long ms) {
+    double hour = (double)(ms % DAY) / HOUR;
+    if (hour < 6 || hour >= 20) return 0;
+    if (hour < 7) return hour - 6;
+    if (hour >= 19) return 20 - hour;
+    return 1;
+}
+
+static int clamp(double light) {
+    return light < 0 ? 0 : light > MAX_LIGHT ? MAX_LIGHT : (int)light;
+}
+
+/**
+ * @brief Clear day: slow dawn and dusk under the noise of the ADC
+ */
+static int clear(unsigned long ms) {
+    return clamp(10 + 990 * sun(ms) + noise(12));
+}
+
+/**
+ * @brief Overcast day: the light hovers over the thresholds as clouds
+ *        of a few minutes pass
+ */
+static int overcast(unsigned long ms) {
+    double t = ms / 60000.0;
+    double clouds = 1 - 0.25 * (1 + sin(2 * M_PI * t / 11)) * (0.6 + 0.4 * sin(2 * M_PI * t / 3));
+    return clamp(10 + 250 * sun(ms) * clouds + noise(12));
+}
+
+/**
+ * @brief Clear day, and a car lighting the photocell for 4 s every 17
+ *        minutes
+ */
+static int headlights(unsigned long ms) {
+    bool car = ms % (17 * 60000) >= 60000 && ms % (17 * 60000) < 64000;
+    return clamp(clear(ms) + (car && sun(ms) == 0 ? 600 : 0));
+}
+
+static const struct {
+    const char* name;
+    int (*trace)(unsigned long ms);
+} traces[] = {
+    {"clear", clear},
+    {"overcast", overcast},
+    {"headlights", headlights},
+};
+
+/**
+ * @brief Servo runs of the first firmware over a day: the blinds close
+ *        on the first reading below the threshold once opened, and the
+ *        other way round; a travel takes Board::travel ms
+ */
+static unsigned long raw(int (*trace)(unsigned long ms)) {
+    unsigned long runs = 0, until = 0;
+    bool opened = trace(0) >= RAW_THRESHOLD;
+    for (unsigned long ms = 0; ms < DAY; ms += RAW_PERIOD) {
+        if (ms < until) continue;
+        bool night = trace(ms) < RAW_THRESHOLD;
+        if (night == opened) {
+            opened = !night;
+            until = ms + Board::travel;
+            runs++;
+        }
+    }
+    return runs;
+}
+
+/**
+ * @brief The trace being replayed, from midnight at origin
+ */
+static int (*replayed)(unsigned long ms);
+static unsigned long origin;
+
+static int replay(unsigned long ms) {
+    return replayed(ms - origin);
+}
+
+/**
+ * @brief Servo runs of this firmware over a day in automatic mode; the
+ *        filter first settles on the light at midnight
+ */
+static unsigned long filtered(int (*trace)(unsigned long ms), const char* settings) {
+    Simulator::inject(SIM_OBJECT_COMMANDS, settings);
+    Simulator::light = trace(0);
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds.setMode(i, BM_AUTOMATIC);
+    loopFor(600000);
+    unsigned long runs = 0;
+    BlindsState previous = blinds.getState(0);
+    replayed = trace;
+    origin = millis();
+    Simulator::lightTrace = replay;
+    while (millis() - origin < DAY) {
+        loop();
+        BlindsState state = blinds.getState(0);
+        if (state != previous && (state == BS_OPENING || state == BS_CLOSING)) runs++;
+        previous = state;
+    }
+    Simulator::lightTrace = NULL;
+    Simulator::light = MAX_LIGHT;
+    return runs;
+}
+
+/**
+ * @brief A set_photocell dropped by a full queue leaves no threshold
+ *        behind for the next one to save
+ */
+static void dropped() {
+    unsigned long before = commandQueue.getDropped();
+    saturate();
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"night\":190}");
+    loopFor(100);
+    bool full = commandQueue.getDropped() == before + 1;
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"dwell\":30}");
+    loopFor(100);
+    bool kept = Repository::cached().getPhotocell().night == 150;
+    printf("set_photocell dropped by a full queue: %s\n", kept ? "forgotten" : "SAVED LATER");
+    expect(full && kept, "set_photocell dropped by a full queue is forgotten");
+}
+
+/**
+ * @brief Changes the thresholds over MQTT and checks that they are kept
+ *        and that inverted ones are refused
+ */
+static void configure() {
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"night\":120,\"day\":220,\"dwell\":45}");
+    loopFor(100);
+    PhotocellSettings kept = Repository::cached().getPhotocell();
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"day\":100}");
+    loopFor(100);
+    PhotocellSettings refused = Repository::cached().getPhotocell();
+    bool valid = kept.night == 120 && kept.day == 220 && kept.dwell == 45 && refused.day == 220;
+    printf("set_photocell: night=%u day=%u dwell=%u s, inverted refused, %s\n",
+        kept.night, kept.day, kept.dwell, valid ? "valid" : "INVALID");
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"night\":150,\"day\":200,\"dwell\":30}");
+    loopFor(100);
+    dropped();
+}
+
+/**
+ * @brief Each trace with the rule of the first firmware, then with the
+ *        filter and its default dwell, then with a dwell of 5 minutes
+ */
+void benchPhotocell() {
+    for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+        srand(1);
+        unsigned long before = raw(traces[i].trace);
+        srand(1);
+        unsigned long after = filtered(traces[i].trace, "{\"cmd\":\"set_photocell\",\"dwell\":30}");
+        srand(1);
+        unsigned long longer = filtered(traces[i].trace, "{\"cmd\":\"set_photocell\",\"dwell\":300}");
+        printf("%-10s servo runs per day: raw threshold %4lu, filtered %3lu, filtered with a 5 min dwell %3lu\n",
+            traces[i].name, before, after, longer);
+    }
+    Samples cpu;
+    for (int i = 0; i < 100; i++) {
+        Stopwatch watch;
+        for (int j = 0; j < 1000; j++) blinds.isNightTime(j % CHANNELS);
+        cpu.add(watch.elapsedUs());
+    }
+    cpu.report("Blinds::isNightTime() cpu", "ns");
+    configure();
+    manual();
+}
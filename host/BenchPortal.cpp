@@ -0,0 +1,261 @@
+/**
+ * @file BenchPortal.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Load generator for the configuration portal
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <ArduinoJson.h>
+#include <map>
+
+extern Storage storage;
+
+/**
+ * Requests per scenario and virtual time of one loop() pass
+ */
+#define LOAD_REQUESTS 20000
+#define LOAD_TICK     100
+
+/**
+ * A slow phone sends one byte every SLOW_BYTE us
+ */
+#define SLOW_BYTE     20000
+
+/**
+ * The form posts the default values back, with one escaped character
+ */
+#define FORM "ssid=" DEF_SSID "&password=&name=XXX%72ycXXX&mqtt_server=" DEF_MQTT_SERVER "&mqtt_port=" DEF_MQTT_PORT
+
+/**
+ * @brief Requests sent by the generator and the status each expects
+ */
+static const struct {
+    const char* request;
+    const char* status;
+} requests[] = {
+    {"GET / HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept-Encoding: gzip\r\n\r\n", "HTTP/1.1 200"},
+    {"GET / HTTP/1.1\r\nHost: 192.168.4.1\r\nIf-None-Match: " PORTAL_ETAG "\r\n\r\n", "HTTP/1.1 304"},
+    {"GET /values HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n", "HTTP/1.1 200"},
+    {"GET /values HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n", "HTTP/1.1 200"},
+    {"GET /favicon.ico HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n", "HTTP/1.1 404"},
+};
+
+/**
+ * @brief One client of the generator; it opens a new connection as
+ *        soon as its previous request is answered
+ */
+struct Peer {
+    std::shared_ptr<Socket> socket;
+    std::string request;
+    const char* status;
+    std::string response;
+    uint64_t started;
+    uint64_t nextByte;
+    bool slow;
+};
+
+static void start(Peer& peer, bool post) {
+    static char form[256];
+    if (post) {
+        snprintf(form, sizeof(form), "POST /postform/ HTTP/1.1\r\nHost: 192.168.4.1\r\n"
+            "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %u\r\n\r\n%s",
+            (unsigned)strlen(FORM), FORM);
+        peer.request = form;
+        peer.status = "HTTP/1.1 200";
+    } else {
+        int i = random(sizeof(requests) / sizeof(requests[0]));
+        peer.request = requests[i].request;
+        peer.status = requests[i].status;
+    }
+    peer.response.clear();
+    peer.socket = Simulator::connect();
+    peer.started = Simulator::now;
+    peer.nextByte = Simulator::now;
+}
+
+/**
+ * @brief Runs fast clients, and optionally slow ones, against the
+ *        portal until LOAD_REQUESTS fast requests are answered
+ */
+static void scenario(SoftAccessPoint& portal, int fast, int slow) {
+    std::vector<Peer> peers(fast + slow);
+    Samples latency, slowLatency;
+    unsigned long errors = 0, answered = 0;
+    double cpu = 0;
+    for (size_t i = 0; i < peers.size(); i++) {
+        peers[i].slow = (int)i >= fast;
+        start(peers[i], false);
+    }
+    while (answered < LOAD_REQUESTS) {
+        for (size_t i = 0; i < peers.size(); i++) {
+            Peer& peer = peers[i];
+            if (!peer.request.empty() && Simulator::now >= peer.nextByte) {
+                size_t length = peer.slow ? 1 : peer.request.size();
+                peer.socket->in.append(peer.request, 0, length);
+                peer.request.erase(0, length);
+                peer.nextByte = Simulator::now + SLOW_BYTE;
+            }
+            peer.response += peer.socket->out;
+            peer.socket->out.clear();
+            if (!peer.socket->closed) continue;
+            if (peer.response.compare(0, strlen(peer.status), peer.status)) errors++;
+            double ms = (Simulator::now - peer.started) / 1000.0;
+            if (peer.slow) slowLatency.add(ms);
+            else {
+                latency.add(ms);
+                answered++;
+            }
+            start(peer, !peer.slow && random(20) == 0);
+        }
+        Stopwatch watch;
+        portal.loop();
+        cpu += watch.elapsedUs();
+        Simulator::advance(LOAD_TICK);
+    }
+
+    /**
+     * Hang up the requests still in flight
+     */
+    for (size_t i = 0; i < peers.size(); i++) peers[i].socket->peerClosed = true;
+    for (int i = 0; i < 10; i++) portal.loop();
+    unsigned long total = latency.count() + slowLatency.count();
+    printf("%d fast + %d slow clients: %.0f requests/s of CPU, %lu errors\n", fast, slow, total / (cpu / 1e6), errors);
+    latency.report("fast client latency", "ms");
+    if (slow) slowLatency.report("slow client latency", "ms");
+}
+
+/**
+ * @brief A whole form posted to the portal
+ */
+static std::string post(const char* form) {
+    char request[256];
+    snprintf(request, sizeof(request), "POST /postform/ HTTP/1.1\r\nHost: 192.168.4.1\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: %u\r\n\r\n%s",
+        (unsigned)strlen(form), form);
+    return request;
+}
+
+/**
+ * @brief Sends one whole request to the portal and returns the response
+ */
+static std::string exchange(SoftAccessPoint& portal, const std::string& request) {
+    std::shared_ptr<Socket> socket = Simulator::connect();
+    socket->in = request;
+    std::string response;
+    for (int i = 0; i < 100 && !socket->closed; i++) {
+        portal.loop();
+        response += socket->out;
+        socket->out.clear();
+        Simulator::advance(LOAD_TICK);
+    }
+    return response;
+}
+
+/**
+ * @brief The portal of a device whose flash is blank, as on its first
+ *        boot: /values must be valid JSON, and a form with an empty
+ *        password must save an empty one and not echo it
+ */
+static void blank(SoftAccessPoint& portal) {
+    std::map<uint32_t, std::vector<uint8_t> > flash = Simulator::flash;
+
+    /**
+     * The cache is read again after a save; the flash is erased behind it
+     */
+    Repository().save();
+    Simulator::flash.clear();
+    storage.mount();
+
+    std::string values = exchange(portal, requests[2].request);
+    size_t body = values.find("\r\n\r\n");
+    StaticJsonDocument<JSON_OBJECT_SIZE(8)> doc;
+    bool json = body != std::string::npos && !deserializeJson(doc, values.c_str() + body + 4) &&
+        values.find('\xff') == std::string::npos;
+
+    std::string saved = exchange(portal, post("ssid=home&password=&name=kitchen&mqtt_server=broker&mqtt_port=1883"));
+    bool empty = !*Repository::cached().getPassword() && saved.find('\xff') == std::string::npos;
+    saved = exchange(portal, post("ssid=home&password=secret&name=kitchen&mqtt_server=broker&mqtt_port=1883"));
+    bool hidden = !strcmp(Repository::cached().getPassword(), "secret") && saved.find("secret") == std::string::npos;
+    printf("blank flash: /values %s, empty password %s, password %s in the response\n", json ? "valid JSON" : "INVALID",
+        empty ? "saved empty" : "NOT EMPTY", hidden ? "hidden" : "ECHOED");
+    expect(json && empty && hidden, "portal on blank flash");
+
+    Simulator::flash = flash;
+    storage.mount();
+    Repository restored;
+    restored.load();
+    restored.save();
+}
+
+/**
+ * Body as long as the buffer of a response, which cannot fit after the
+ * headers
+ */
+static HttpServer server(8080);
+static char large[MAX_HTTP_RESPONSE + 1];
+
+static void handleLarge(HttpSession& session) {
+    server.send(session, 200, "text/plain", large);
+}
+
+static void handleSmall(HttpSession& session) {
+    server.send(session, 200, "text/plain", large + MAX_HTTP_RESPONSE - 512);
+}
+
+/**
+ * @brief Status of a GET and whether its Content-Length is the length
+ *        of the body received
+ */
+static int get(const char* uri, bool& framed) {
+    std::shared_ptr<Socket> socket = Simulator::connect();
+    socket->in = std::string("GET ") + uri + " HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n";
+    std::string response;
+    for (int i = 0; i < 100 && !socket->closed; i++) {
+        server.loop();
+        response += socket->out;
+        socket->out.clear();
+        Simulator::advance(LOAD_TICK);
+    }
+    size_t body = response.find("\r\n\r\n");
+    size_t field = response.find("Content-Length: ");
+    framed = body != std::string::npos && field != std::string::npos &&
+        strtoul(response.c_str() + field + 16, nullptr, 10) == response.size() - body - 4;
+    return atoi(response.c_str() + 9);
+}
+
+/**
+ * @brief A body that fits after the headers is sent whole, one that
+ *        does not is refused; both match their Content-Length
+ */
+static void oversized() {
+    memset(large, 'x', MAX_HTTP_RESPONSE);
+    server.on("/large", handleLarge);
+    server.on("/small", handleSmall);
+    server.begin();
+    bool smallFramed, largeFramed;
+    int small = get("/small", smallFramed);
+    int refused = get("/large", largeFramed);
+    printf("body of %u bytes: %d, %s; body of %u bytes: %d, %s\n", 512, small, smallFramed ? "framed" : "MISFRAMED",
+        (unsigned)MAX_HTTP_RESPONSE, refused, largeFramed ? "framed" : "MISFRAMED");
+    expect(small == 200 && smallFramed && refused == 500 && largeFramed, "responses match their Content-Length");
+}
+
+/**
+ * @brief Requests per second and tail latency of the portal, with and
+ *        without slow clients holding sessions, then its first boot on
+ *        blank flash, and responses too large for their buffer
+ */
+void benchPortal() {
+    SoftAccessPoint portal;
+    portal.setup();
+    scenario(portal, 8, 0);
+    scenario(portal, 6, 2);
+    if (strcmp(Repository::cached().getName(), DEF_NAME)) printf("form decoding error: %s\n", Repository::cached().getName());
+    blank(portal);
+    oversized();
+}
@@ -0,0 +1,98 @@
+/**
+ * @file BenchPower.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Energy of the power modes over a simulated hour, and the
+ *        command latency they trade it for
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+extern Blinds blinds;
+extern Connection connection;
+extern Scheduler scheduler;
+void loop();
+
+/**
+ * Currents of the ESP8266 datasheet in mA: receiving, modem sleep and
+ * light sleep
+ */
+#define CURRENT_RADIO 56.0
+#define CURRENT_AWAKE 15.0
+#define CURRENT_LIGHT 0.9
+
+/**
+ * A command every POWER_COMMANDS ms, at a random time
+ */
+#define POWER_HOUR     3600000
+#define POWER_COMMANDS 60000
+
+static uint64_t statePublishedAt;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (!strcmp(topic, SIM_OBJECT_STATES)) statePublishedAt = Simulator::now;
+}
+
+/**
+ * @brief Runs an hour of commands in a power mode and reports what the
+ *        chip spent per hour
+ *
+ * @param name
+ * @param mode
+ * @param pollPeriod overrides the one of the mode when not 0
+ */
+static void hour(const char* name, PowerMode mode, unsigned long pollPeriod) {
+    connection.setPowerMode(mode);
+    if (pollPeriod) scheduler.setPollPeriod(pollPeriod);
+    loopFor(5000);
+    Samples latency;
+    unsigned long reconnects = connection.getReconnects();
+    unsigned long published = Simulator::published;
+    Simulator::energy = Energy();
+    uint64_t start = Simulator::now;
+    for (int i = 0; i < POWER_HOUR / POWER_COMMANDS; i++) {
+        uint64_t end = Simulator::now + POWER_COMMANDS * 1000ULL;
+        loopFor(random(POWER_COMMANDS - 10000));
+
+        /**
+         * Sent at any time, not only when a poll is due
+         */
+        uint64_t delay = random(POWER_PERIOD * 1000);
+        uint64_t sent = Simulator::now + delay;
+        statePublishedAt = 0;
+        Simulator::inject(SIM_OBJECT_COMMANDS, i & 1 ? "{\"cmd\":\"close\"}" : "{\"cmd\":\"open\"}", delay);
+        while (!statePublishedAt && Simulator::now < end) loop();
+        if (statePublishedAt) latency.add((statePublishedAt - sent) / 1000.0);
+        while (Simulator::now < end) loop();
+    }
+    double elapsed = Simulator::now - start;
+    double asleep = Simulator::energy.asleep;
+    double radio = Simulator::energy.radio;
+    double awake = elapsed - asleep;
+    double current = (radio * CURRENT_RADIO + (awake - radio) * CURRENT_AWAKE + asleep * CURRENT_LIGHT) / elapsed;
+    double scale = POWER_HOUR * 1000.0 / elapsed;
+    printf("%-16s awake %8.0f ms/h, radio %8.0f ms/h, %6.0f wakeups/h, mean %5.2f mA, %lu published, %lu reconnects\n",
+        name, awake * scale / 1000, radio * scale / 1000, Simulator::energy.wakeups * scale, current,
+        Simulator::published - published, connection.getReconnects() - reconnects);
+    latency.report("command latency", "ms");
+}
+
+/**
+ * @brief The power modes one after the other, on the same device; each
+ *        sees 60 open and close commands in an hour
+ */
+void benchPower() {
+    manual();
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds.close(i);
+    Simulator::onPublish = onPublish;
+    hour("awake", PM_AWAKE, 0);
+    hour("modem sleep", PM_MODEM_SLEEP, 0);
+    hour("light sleep", PM_LIGHT_SLEEP, 0);
+    hour("light sleep 1 s", PM_LIGHT_SLEEP, 1000);
+    Simulator::onPublish = NULL;
+    connection.setPowerMode(POWER_MODE);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file BenchPublish.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Outbound state messages: size, cost and delivery across outages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <ArduinoJson.h>
+#include <math.h>
+
+extern Blinds blinds;
+extern Publisher publisher;
+void loop();
+
+static std::string retained;
+static unsigned long messages, bytes, prettyBytes;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retain) {
+    if (strcmp(topic, SIM_OBJECT_STATES)) return;
+    retained.assign((const char*)payload, length);
+    messages++;
+    bytes += length;
+
+    /**
+     * Size the same message would have had pretty-printed
+     */
+    StaticJsonDocument<256> doc;
+    String pretty;
+    deserializeJson(doc, payload, length);
+    serializeJsonPretty(doc, pretty);
+    prettyBytes += pretty.length();
+}
+
+/**
+ * @brief Position and state of the first channel in the retained message
+ */
+static bool reports(const std::string& message, int position, const char* state) {
+    char text[80];
+    snprintf(text, sizeof(text), "\"objects\":[{\"state\":\"%s\",\"mode\":\"manual\",\"position\":%d}", state, position);
+    return message.find(text) != std::string::npos;
+}
+
+/**
+ * @brief The first channel travels from closed to the same positions,
+ *        with the broker reachable or not; the blinds are put back at
+ *        the closed end by hand first
+ *
+ * @param reachable
+ * @param error rest vs reported, in %
+ */
+static void offline(bool reachable, Samples& error) {
+    Motor& motor = Simulator::motors[Board::servoPin(0)];
+    blinds.close(0);
+    loopFor(2500);
+    motor.position = 0;
+    Simulator::brokerUp = reachable;
+    for (int i = 0; i < 200; i++) {
+        blinds.close(0);
+        loopFor(2500);
+        blinds.setPosition(0, (i * 37 + 5) % 101);
+        loopFor(3000);
+        error.add(fabs(motor.position * 100 - blinds.getPosition(0)));
+    }
+    Simulator::brokerUp = true;
+    loopUntilPublished(1, 120000);
+}
+
+/**
+ * @brief While the broker is unreachable, the attempts to reach it on
+ *        the backoff must not throw the travels off
+ */
+static void offline() {
+    Samples up, down;
+    offline(true, up);
+    offline(false, down);
+    up.report("set_position, broker reachable: rest vs reported", "%");
+    down.report("set_position, broker unreachable: rest vs reported", "%");
+    expect(down.percentile(100) <= up.percentile(100) + 0.5, "travels with the broker unreachable as with it reachable");
+}
+
+/**
+ * @brief Bytes per open cycle, then broker outages with transitions
+ *        in the middle: the retained state must catch up on reconnect
+ */
+void benchPublish() {
+    Simulator::onPublish = onPublish;
+    manual();
+    loopFor(2500);
+
+    messages = bytes = prettyBytes = 0;
+    for (int i = 0; i < 100; i++) {
+        blinds.open(0);
+        loopFor(2500);
+        blinds.close(0);
+        loopFor(2500);
+    }
+    printf("open/close cycle: %.1f messages, %.0f bytes (%.0f pretty-printed)\n",
+        messages / 100.0, bytes / 100.0, prettyBytes / 100.0);
+
+    Samples catchUp;
+    unsigned long stale = 0;
+    unsigned long sent = publisher.getSent();
+    unsigned long dropped = publisher.getDropped();
+    for (int i = 0; i < 200; i++) {
+        Simulator::brokerUp = false;
+        loopFor(200 + random(2000));
+        blinds.setPosition(0, random(101));
+        loopFor(2500);
+        Simulator::brokerUp = true;
+        uint64_t back = Simulator::now;
+        const char* state = blinds.getState(0) == BS_CLOSED ? "closed" : "opened";
+        while (!reports(retained, blinds.getPosition(0), state) && Simulator::now - back < 120000000ULL) loop();
+        if (reports(retained, blinds.getPosition(0), state)) catchUp.add((Simulator::now - back) / 1000.0);
+        else stale++;
+    }
+    Simulator::onPublish = NULL;
+    catchUp.report("broker back to retained state", "ms");
+    printf("outages=200 stale=%lu sent=%lu dropped=%lu\n",
+        stale, publisher.getSent() - sent, publisher.getDropped() - dropped);
+    offline();
+}
@@ -0,0 +1,90 @@
+/**
+ * @file BenchQuery.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Replies of a fleet to a broadcast query_objects
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <algorithm>
+
+void loop();
+
+/**
+ * Simulated fleet: devices 192.168.0.1 and up, each polling MQTT every
+ * 10 ms at a random phase
+ */
+#define FLEET_SIZE  200
+#define FLEET_POLL  10
+#define FLEET_BURST 100
+
+static unsigned long replies;
+static uint64_t replied;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retain) {
+    if (strcmp(topic, "/IOT3/STATES") || *payload != '{') return;
+    if (replies++ == 0) replied = Simulator::now;
+}
+
+/**
+ * @brief Largest number of replies the broker sees within FLEET_BURST
+ *        ms, and the time of the last one
+ */
+static void fleet(unsigned long window) {
+    std::vector<unsigned long> times;
+    for (uint32_t id = 1; id <= FLEET_SIZE; id++) {
+        times.push_back(BlindsStub::jitter(id, window) + random(FLEET_POLL));
+    }
+    std::sort(times.begin(), times.end());
+    size_t burst = 0;
+    for (size_t i = 0, j = 0; i < times.size(); i++) {
+        while (times[i] - times[j] >= FLEET_BURST) j++;
+        burst = std::max(burst, i - j + 1);
+    }
+    printf("window %5lu ms: %3zu of %d replies within %d ms, last after %lu ms\n",
+        window, burst, FLEET_SIZE, FLEET_BURST, times.back());
+}
+
+/**
+ * @brief Burst size and completion time of a fleet, then the delay of
+ *        the simulated device against the one it should have drawn
+ */
+void benchQuery() {
+    fleet(0);
+    fleet(1000);
+    fleet(2000);
+    fleet(5000);
+
+    Simulator::onPublish = onPublish;
+    Samples error;
+    unsigned long duplicates = 0, missing = 0;
+    for (int i = 0; i < 200; i++) {
+        unsigned long window = random(5000);
+        char query[64];
+        snprintf(query, sizeof(query), "{\"cmd\":\"query_objects\",\"window\":%lu}", window);
+        replies = 0;
+        uint64_t sent = Simulator::now;
+        Simulator::inject(SIM_HOME_COMMANDS, query);
+
+        /**
+         * A second query read before the reply is answered by the same
+         * reply
+         */
+        unsigned long delay = BlindsStub::jitter(ESP.getChipId(), window);
+        if (delay > 2 * FLEET_POLL) Simulator::inject(SIM_HOME_COMMANDS, query, delay * 500);
+        loopFor(window + 200);
+        if (replies == 0) missing++;
+        else {
+            duplicates += replies - 1;
+            error.add((replied - sent) / 1000.0 - delay);
+        }
+        loopFor(window);
+    }
+    Simulator::onPublish = NULL;
+    error.report("reply delay past its jitter", "ms");
+    printf("queries=200 missing=%lu duplicates=%lu\n", missing, duplicates);
+}
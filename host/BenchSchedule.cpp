@@ -0,0 +1,402 @@
+/**
+ * @file BenchSchedule.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Sunrise and sunset of the schedule against the full NOAA
+ *        equations and an almanac, a week of rules run over MQTT, the
+ *        photocell fallback while the clock is not set and the CPU cost
+ *        of the schedule
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <math.h>
+
+extern Blinds blinds;
+extern CommandQueue commandQueue;
+void loop();
+
+#define DAY 86400L
+
+static double radians(double degrees) {return degrees * M_PI / 180;}
+static double degrees(double radians) {return radians * 180 / M_PI;}
+
+/**
+ * @brief Days from 1970-01-01 to a date of the Gregorian calendar
+ */
+static long civil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief Sunrise or sunset by the equations of the NOAA solar
+ *        calculator, with the equation of time and the nutation, solved
+ *        again at the time of the event
+ *
+ * @param latitude in degrees, north positive
+ * @param longitude in degrees, east positive
+ * @param day around the solar noon of which the event falls
+ * @param rising sunrise, else sunset
+ * @return double UTC time in s, NAN when the sun does not rise or set
+ */
+static double noaa(double latitude, double longitude, long day, bool rising) {
+    double time = day * (double)DAY + 43200 - longitude * 240;
+    for (int iteration = 0; iteration < 3; iteration++) {
+        double t = (time / DAY + 2440587.5 - 2451545) / 36525;
+        double mean = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360);
+        double anomaly = 357.52911 + t * (35999.05029 - 0.0001537 * t);
+        double eccentricity = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+        double m = radians(anomaly);
+        double centre = sin(m) * (1.914602 - t * (0.004817 + 0.000014 * t)) + sin(2 * m) * (0.019993 - 0.000101 * t) +
+            sin(3 * m) * 0.000289;
+        double omega = radians(125.04 - 1934.136 * t);
+        double apparent = radians(mean + centre - 0.00569 - 0.00478 * sin(omega));
+        double obliquity = radians(23 + (26 + (21.448 - t * (46.815 + t * (0.00059 - t * 0.001813))) / 60) / 60 +
+            0.00256 * cos(omega));
+        double declination = asin(sin(obliquity) * sin(apparent));
+        double y = tan(obliquity / 2) * tan(obliquity / 2);
+        double l = radians(mean);
+        double equation = 4 * degrees(y * sin(2 * l) - 2 * eccentricity * sin(m) + 4 * eccentricity * y * sin(m) * cos(2 * l) -
+            0.5 * y * y * sin(4 * l) - 1.25 * eccentricity * eccentricity * sin(2 * m));
+        double phi = radians(latitude);
+        double angle = cos(radians(90.833)) / (cos(phi) * cos(declination)) - tan(phi) * tan(declination);
+        if (angle < -1 || angle > 1) return NAN;
+        double noon = day * (double)DAY + (720 - 4 * longitude - equation) * 60;
+        time = noon + (rising ? -1 : 1) * 4 * degrees(acos(angle)) * 60;
+    }
+    return time;
+}
+
+static Schedule located(double latitude, double longitude, int offset) {
+    ScheduleSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.latitude = lround(latitude * 100);
+    settings.longitude = lround(longitude * 100);
+    settings.offset = offset;
+    Schedule schedule;
+    schedule.set(settings);
+    return schedule;
+}
+
+/**
+ * @brief Every day of a year at a few latitudes against the NOAA
+ *        equations; days where only one of the two sees the sun rise
+ *        and set are counted apart
+ */
+static void sweep() {
+    static const double latitudes[] = {0, 30, -33.87, 45.5, 51.51, 60, 65};
+    Samples error;
+    unsigned long polar = 0, mismatched = 0;
+    long first = civil(2026, 1, 1);
+    for (size_t i = 0; i < sizeof(latitudes) / sizeof(latitudes[0]); i++) {
+        double longitude = -73.57 + 45 * i;
+        Schedule schedule = located(latitudes[i], longitude, 0);
+        for (long day = first; day < first + 365; day++) {
+            time_t rise, set;
+            bool up = schedule.sun(day, rise, set);
+            double reference = noaa(schedule.get().latitude / 100.0, schedule.get().longitude / 100.0, day, true);
+            if (isnan(reference) || !up) {
+                if (isnan(reference) != !up) mismatched++;
+                polar++;
+                continue;
+            }
+            error.add(fabs(rise - reference));
+            error.add(fabs(set - noaa(schedule.get().latitude / 100.0, schedule.get().longitude / 100.0, day, false)));
+        }
+    }
+    error.report("sun events vs NOAA, 7 latitudes x 365", "s");
+    printf("days without sunrise or sunset: %lu, disagreeing with NOAA: %lu\n", polar, mismatched);
+}
+
+/**
+ * @brief A few published times, local and rounded to the minute
+ */
+static const struct {
+    const char* place;
+    double latitude;
+    double longitude;
+    int offset;
+    int year, month, day;
+    int rise, set;
+} almanac[] = {
+    {"London 2024-06-20", 51.5074, -0.1278, 60, 2024, 6, 20, 4 * 60 + 43, 21 * 60 + 21},
+    {"London 2024-12-21", 51.5074, -0.1278, 0, 2024, 12, 21, 8 * 60 + 4, 15 * 60 + 53},
+    {"Sydney 2024-06-21", -33.8688, 151.2093, 600, 2024, 6, 21, 7 * 60 + 0, 16 * 60 + 54},
+    {"Tromso 2024-06-21", 69.6492, 18.9553, 120, 2024, 6, 21, -1, -1},
+    {"Tromso 2024-12-21", 69.6492, 18.9553, 60, 2024, 12, 21, -1, -1},
+};
+
+static void published() {
+    for (size_t i = 0; i < sizeof(almanac) / sizeof(almanac[0]); i++) {
+        Schedule schedule = located(almanac[i].latitude, almanac[i].longitude, almanac[i].offset);
+        long day = civil(almanac[i].year, almanac[i].month, almanac[i].day);
+        time_t rise, set;
+        if (!schedule.sun(day, rise, set)) {
+            printf("%-18s no sunrise or sunset, almanac %s\n", almanac[i].place, almanac[i].rise < 0 ? "agrees" : "DISAGREES");
+            continue;
+        }
+        double local = day * (double)DAY - almanac[i].offset * 60;
+        printf("%-18s sunrise %+5.0f s, sunset %+5.0f s from the almanac\n", almanac[i].place,
+            rise - local - almanac[i].rise * 60, set - local - almanac[i].set * 60);
+    }
+}
+
+/**
+ * London in summer time: the blinds open at 7:00 on weekdays and an
+ * hour after sunrise on weekends, and close 15 minutes before sunset;
+ * the second channel is half closed from 13:00 to 15:30 on weekdays
+ */
+#define LATITUDE  51.5074
+#define LONGITUDE -0.1278
+#define OFFSET    60
+#define WEEKDAYS  0x3e
+#define WEEKEND   0x41
+#define EVERY_DAY 0x7f
+
+static const struct {
+    const char* topic;
+    uint8_t days;
+    uint8_t event;
+    int minute;
+    uint8_t position;
+} rules[] = {
+    {SIM_OBJECT_COMMANDS, WEEKDAYS, SE_TIME, 7 * 60, 100},
+    {SIM_OBJECT_COMMANDS, WEEKEND, SE_SUNRISE, 60, 100},
+    {SIM_OBJECT_COMMANDS, EVERY_DAY, SE_SUNSET, -15, 0},
+    {SIM_OBJECT_COMMANDS "/1", WEEKDAYS, SE_TIME, 13 * 60, 40},
+    {SIM_OBJECT_COMMANDS "/1", WEEKDAYS, SE_TIME, 15 * 60 + 30, 100},
+};
+
+#define RULES (sizeof(rules) / sizeof(rules[0]))
+
+static const char* events[] = {"", "time", "sunrise", "sunset"};
+
+/**
+ * @brief Wall clock of the simulation
+ */
+static double wall() {return Simulator::epoch + Simulator::now / 1e6;}
+
+/**
+ * @brief Sets the wall clock to a UTC time
+ */
+static void setClock(double utc) {
+    Simulator::epoch = (time_t)utc - (time_t)(Simulator::now / 1000000);
+}
+
+/**
+ * @brief Time a rule moves a channel
+ */
+struct Boundary {
+    double at;
+    uint8_t channel;
+    uint8_t event;
+    bool matched;
+};
+
+/**
+ * @brief When each rule moves each channel over a week from a local
+ *        Monday, by the NOAA equations for the sun
+ */
+static void expected(long monday, std::vector<Boundary>& boundaries) {
+    for (long day = monday; day < monday + 7; day++) {
+        int weekday = (day + 4) % 7;
+        for (size_t i = 0; i < RULES; i++) {
+            if (!(rules[i].days & (1 << weekday))) continue;
+            double at = rules[i].event == SE_TIME ? day * (double)DAY - OFFSET * 60 :
+                noaa(LATITUDE, LONGITUDE, day, rules[i].event == SE_SUNRISE);
+            at += rules[i].minute * 60;
+            for (uint8_t channel = 0; channel < 2; channel++) {
+                if (strcmp(rules[i].topic, SIM_OBJECT_COMMANDS) && channel != 1) continue;
+                Boundary boundary = {at, channel, rules[i].event, false};
+                boundaries.push_back(boundary);
+            }
+        }
+    }
+}
+
+/**
+ * @brief A week of rules sent over MQTT, the photocell reading the
+ *        night all along; the broker is down from Wednesday to Friday.
+ *        Each move start is matched with the boundary that caused it
+ */
+static void week() {
+    long monday = civil(2026, 6, 15);
+    setClock(monday * (double)DAY - OFFSET * 60 - 3600);
+    Simulator::light = 0;
+    char command[128];
+    snprintf(command, sizeof(command), "{\"cmd\":\"set_schedule\",\"latitude\":%.4f,\"longitude\":%.4f,\"offset\":%d}",
+        LATITUDE, LONGITUDE, OFFSET);
+    Simulator::inject(SIM_OBJECT_COMMANDS, command);
+    for (size_t i = 0; i < RULES; i++) {
+        snprintf(command, sizeof(command), "{\"cmd\":\"set_rule\",\"rule\":%u,\"days\":%u,\"event\":\"%s\",\"minute\":%d,\"position\":%u}",
+            (unsigned)i, rules[i].days, events[rules[i].event], rules[i].minute, rules[i].position);
+        Simulator::inject(rules[i].topic, command);
+    }
+    loopFor(100);
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds.setMode(i, BM_AUTOMATIC);
+    loopFor(60000);
+
+    std::vector<Boundary> boundaries;
+    expected(monday, boundaries);
+    Samples timed, sun, offline;
+    unsigned long unexpected = 0, moves = 0;
+    BlindsState previous[2] = {blinds.getState(0), blinds.getState(1)};
+    double end = monday * (double)DAY - OFFSET * 60 + 7 * DAY;
+    double down = end - 5 * DAY, up = end - 3 * DAY;
+    bool cut = false;
+    while (wall() < end) {
+        if (!cut && wall() >= down) Simulator::brokerUp = false, cut = true;
+        if (cut && wall() >= up) Simulator::brokerUp = true;
+        loop();
+        for (uint8_t channel = 0; channel < 2; channel++) {
+            BlindsState state = blinds.getState(channel);
+            bool started = state != previous[channel] && (state == BS_OPENING || state == BS_CLOSING);
+            previous[channel] = state;
+            if (!started) continue;
+            moves++;
+            Boundary* best = NULL;
+            for (size_t k = 0; k < boundaries.size(); k++) {
+                Boundary& boundary = boundaries[k];
+                if (boundary.channel != channel || boundary.matched || fabs(boundary.at - wall()) > 300) continue;
+                if (!best || fabs(boundary.at - wall()) < fabs(best->at - wall())) best = &boundary;
+            }
+            if (!best) {
+                unexpected++;
+                continue;
+            }
+            best->matched = true;
+            double error = wall() - best->at;
+            (best->event == SE_TIME ? timed : sun).add(error);
+            if (wall() >= down && wall() < up) offline.add(error);
+        }
+    }
+    unsigned long missed = 0;
+    for (size_t k = 0; k < boundaries.size(); k++) missed += !boundaries[k].matched;
+    timed.report("time rule: move start after boundary", "s");
+    sun.report("sun rule: move start vs NOAA", "s");
+    offline.report("broker down: move start error", "s");
+    printf("week: %lu boundaries, %lu moves, %lu missed, %lu unexpected (photocell reading night)\n",
+        (unsigned long)boundaries.size(), moves, missed, unexpected);
+}
+
+/**
+ * @brief The clock is lost as at a boot without SNTP: the photocell
+ *        drives the channels until the clock is set, then the schedule
+ *        takes over
+ */
+static void fallback() {
+    Simulator::sntpUp = false;
+    Simulator::synced = false;
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_schedule\"}");
+    loopFor(1000);
+    Simulator::light = MAX_LIGHT;
+    unsigned long start = millis();
+    while (blinds.getState(0) != BS_OPENING && millis() - start < 600000) loop();
+    unsigned long photocell = millis() - start;
+    loopFor(30000);
+
+    /**
+     * Monday 23:00 local: the schedule wants every channel closed
+     */
+    setClock(civil(2026, 6, 22) * (double)DAY - OFFSET * 60 + 23 * 3600);
+    Simulator::sntpUp = true;
+    start = millis();
+    while (blinds.getState(0) != BS_CLOSING && millis() - start < 600000) loop();
+    unsigned long takeover = millis() - start;
+    printf("clock unset: photocell opened after %lu ms of daylight; clock set: schedule closed after %lu ms\n",
+        photocell, takeover);
+    loopFor(30000);
+}
+
+/**
+ * @brief What was saved is what was sent; invalid rules are refused,
+ *        and those dropped by a full queue are not saved with the next
+ *        change
+ */
+static void persistence() {
+    unsigned long dropped = commandQueue.getDropped();
+    saturate();
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_rule\",\"rule\":7,\"days\":1,\"minute\":0,\"position\":0}");
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_schedule\",\"latitude\":0}");
+    loopFor(100);
+    bool full = commandQueue.getDropped() == dropped + 2;
+    char command[64];
+    snprintf(command, sizeof(command), "{\"cmd\":\"set_schedule\",\"offset\":%d}", OFFSET);
+    Simulator::inject(SIM_OBJECT_COMMANDS, command);
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_rule\",\"rule\":8,\"days\":1,\"minute\":0,\"position\":0}");
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_rule\",\"rule\":0,\"days\":1,\"minute\":1440,\"position\":0}");
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_rule\",\"rule\":0,\"days\":1,\"event\":\"noon\",\"position\":0}");
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_schedule\",\"latitude\":91}");
+    loopFor(100);
+    ScheduleSettings saved;
+    bool valid = Repository::loadSchedule(saved) && saved.latitude == lround(LATITUDE * 100) &&
+        saved.longitude == lround(LONGITUDE * 100) && saved.offset == OFFSET;
+    for (size_t i = 0; i < RULES; i++) {
+        const ScheduleRule& rule = saved.rules[i];
+        valid = valid && rule.days == rules[i].days && rule.event == rules[i].event && rule.minute == rules[i].minute &&
+            rule.position == rules[i].position && rule.channels == (!strcmp(rules[i].topic, SIM_OBJECT_COMMANDS) ? (1 << CHANNELS) - 1 : 2);
+    }
+    for (size_t i = RULES; i < MAX_RULES; i++) valid = valid && !saved.rules[i].days;
+    printf("schedule saved: %u bytes, invalid rules refused, %s\n", (unsigned)sizeof(saved), valid ? "valid" : "INVALID");
+    expect(full && valid, "schedule saved as sent, without the commands dropped");
+}
+
+/**
+ * @brief Cost of the schedule with the rules of the week; a wakeup
+ *        runs position() for each channel and next() once
+ */
+static void cpu() {
+    ScheduleSettings settings;
+    Repository::loadSchedule(settings);
+    Schedule schedule;
+    schedule.set(settings);
+    time_t now = civil(2026, 6, 17) * DAY + 12 * 3600;
+    Samples next, position, sun;
+    volatile long sink = 0;
+    for (int round = 0; round < 20; round++) {
+        Stopwatch watch;
+        for (int i = 0; i < 100; i++) sink += schedule.next(now + i * 600);
+        next.add(watch.elapsedUs() * 10);
+        watch = Stopwatch();
+        for (int i = 0; i < 100; i++) sink += schedule.position(i % CHANNELS, now + i * 600);
+        position.add(watch.elapsedUs() * 10);
+        watch = Stopwatch();
+        time_t rise, set;
+        for (int i = 0; i < 100; i++) sink += schedule.sun(civil(2026, 1, 1) + i, rise, set);
+        sun.add(watch.elapsedUs() * 10);
+    }
+    next.report("Schedule::next() cpu", "ns");
+    position.report("Schedule::position() cpu", "ns");
+    sun.report("Schedule::sun() cpu", "ns");
+}
+
+/**
+ * @brief Sun equations, a week of rules, the photocell fallback, then
+ *        the rules are cleared for the suites that follow
+ */
+void benchSchedule() {
+    time_t epoch = Simulator::epoch;
+    sweep();
+    published();
+    week();
+    fallback();
+    persistence();
+    cpu();
+    char command[64];
+    for (size_t i = 0; i < RULES; i++) {
+        snprintf(command, sizeof(command), "{\"cmd\":\"set_rule\",\"rule\":%u,\"days\":0}", (unsigned)i);
+        Simulator::inject(SIM_OBJECT_COMMANDS, command);
+    }
+    loopFor(100);
+    Simulator::light = MAX_LIGHT;
+    Simulator::epoch = epoch;
+    manual();
+}
@@ -0,0 +1,114 @@
+/**
+ * @file BenchSoak.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Long run of commands, publishes and broker outages that counts
+ *        the heap allocations made by the firmware
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <new>
+
+#ifdef BENCHMARK
+void loop();
+
+/**
+ * Commands of a soak, one every SOAK_PERIOD ms; the broker goes away
+ * for SOAK_OUTAGE ms every SOAK_OUTAGES commands
+ */
+#ifndef SOAK_COMMANDS
+#define SOAK_COMMANDS 1000000
+#endif
+#define SOAK_PERIOD   20
+#define SOAK_OUTAGES  50000
+#define SOAK_OUTAGE   5000
+
+/**
+ * @brief Prefix of every block, telling whether it was allocated by
+ *        the firmware
+ */
+struct Block {
+    size_t size;
+    size_t counted;
+};
+
+/**
+ * Only the allocations made while the firmware runs are counted; those
+ * of the benchmark feeding it are not
+ */
+static bool counting = false;
+static unsigned long allocations = 0;
+static size_t live = 0, peak = 0;
+
+static void* allocate(size_t size) {
+    Block* block = (Block*)malloc(sizeof(Block) + size);
+    if (!block) throw std::bad_alloc();
+    block->size = size;
+    block->counted = counting;
+    if (counting) {
+        allocations++;
+        live += size;
+        if (live > peak) peak = live;
+    }
+    return block + 1;
+}
+
+static void release(void* pointer) {
+    if (!pointer) return;
+    Block* block = (Block*)pointer - 1;
+    if (block->counted) live -= block->size;
+    free(block);
+}
+
+void* operator new(size_t size) {return allocate(size);}
+void* operator new[](size_t size) {return allocate(size);}
+void operator delete(void* pointer) noexcept {release(pointer);}
+void operator delete[](void* pointer) noexcept {release(pointer);}
+void operator delete(void* pointer, size_t size) noexcept {release(pointer);}
+void operator delete[](void* pointer, size_t size) noexcept {release(pointer);}
+
+static const char* commands[] = {
+    "{\"cmd\":\"open\"}",
+    "{\"cmd\":\"close\"}",
+    "{\"cmd\":\"stop\"}",
+    "{\"cmd\":\"set_position\",\"position\":40}",
+    "{\"cmd\":\"set_position\",\"position\":75}",
+    "{\"cmd\":\"set_mode\",\"mode\":1}",
+};
+
+/**
+ * @brief Millions of commands on the object and channel topics, home
+ *        queries and broker outages; the firmware should not touch the
+ *        heap once booted
+ */
+void benchSoak() {
+    PublishHook hook = Simulator::onPublish;
+    Simulator::onPublish = NULL;
+    unsigned long published = Simulator::published;
+    Stopwatch watch;
+    char topic[MAX_TOPIC];
+    for (unsigned long i = 0; i < SOAK_COMMANDS; i++) {
+        int channel = random(CHANNELS + 1);
+        if (channel == CHANNELS) snprintf(topic, sizeof(topic), "%s", SIM_OBJECT_COMMANDS);
+        else snprintf(topic, sizeof(topic), "%s/%d", SIM_OBJECT_COMMANDS, channel);
+        if (i % 1000 == 999) Simulator::inject(SIM_HOME_COMMANDS, "{\"cmd\":\"query_objects\",\"window\":0}");
+        else Simulator::inject(topic, commands[random(sizeof(commands) / sizeof(commands[0]))]);
+        if (i % SOAK_OUTAGES == SOAK_OUTAGES - 1) Simulator::brokerUp = false;
+        uint64_t until = Simulator::now + (Simulator::brokerUp ? SOAK_PERIOD : SOAK_OUTAGE) * 1000ULL;
+        counting = true;
+        while (Simulator::now < until) loop();
+        counting = false;
+        Simulator::brokerUp = true;
+    }
+    Simulator::onPublish = hook;
+    published = Simulator::published - published;
+    printf("commands=%d published=%lu in %.1f s of host time for %.0f s of device time\n",
+        SOAK_COMMANDS, published, watch.elapsedUs() / 1e6, Simulator::now / 1e6);
+    printf("firmware heap: allocations=%lu (%.3f per command) live=%zu bytes peak=%zu bytes\n",
+        allocations, (double)allocations / SOAK_COMMANDS, live, peak);
+}
+#endif
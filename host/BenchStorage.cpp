@@ -0,0 +1,78 @@
+/**
+ * @file BenchStorage.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Storage engine endurance and power cut simulation
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+/**
+ * Sectors of the simulated log, away from the ones used by the firmware
+ */
+#define BENCH_SECTOR 100
+
+/**
+ * @brief Fills a record with a recognizable value
+ */
+static size_t fill(RecordType type, uint32_t value, uint8_t* data) {
+    size_t size = type == RT_CONFIG ? 192 : 4;
+    memset(data, value & 0xff, size);
+    memcpy(data, &value, sizeof(value));
+    return size;
+}
+
+/**
+ * @brief Writes state and configuration records in the proportions of
+ *        the firmware and cuts the power at random points. After each
+ *        cut the log is mounted again and every record must hold either
+ *        its last acknowledged value or the value being written. Erase
+ *        counts are compared with one EEPROM commit per write.
+ */
+void benchStorage() {
+    uint32_t acked[RECORD_TYPES + 1] = {0};
+    unsigned long cuts = 0, failures = 0, writes = 20000;
+    uint8_t data[MAX_RECORD];
+    Samples cost, recovery;
+    Storage* storage = new Storage(BENCH_SECTOR);
+
+    for (uint32_t value = 1; value <= writes; value++) {
+        RecordType type = random(20) ? RT_STATE : RT_CONFIG;
+        size_t size = fill(type, value, data);
+        bool cut = random(50) == 0;
+        if (cut) Simulator::flashBudget = random(300);
+
+        Stopwatch watch;
+        if (storage->write(type, data, size)) acked[type] = value;
+        cost.add(watch.elapsedUs());
+        if (!cut) continue;
+
+        /**
+         * Power cut: reboot and check what the log recovered
+         */
+        cuts++;
+        Simulator::flashBudget = -1;
+        delete storage;
+        storage = new Storage(BENCH_SECTOR);
+        Stopwatch mount;
+        storage->mount();
+        recovery.add(mount.elapsedUs());
+        for (int t = RT_CONFIG; t <= RT_STATE; t++) {
+            uint32_t recovered = 0;
+            if (storage->read((RecordType)t, data, sizeof(data))) memcpy(&recovered, data, sizeof(recovered));
+            if (recovered == acked[t] || (t == type && recovered == value)) acked[t] = recovered;
+            else failures++;
+        }
+    }
+    delete storage;
+
+    cost.report("Storage::write() cpu", "us");
+    recovery.report("Storage::mount() cpu", "us");
+    printf("writes=%lu power_cuts=%lu recovery_failures=%lu\n", writes, cuts, failures);
+    printf("erases: sector %d=%lu sector %d=%lu (EEPROM commit per write: %lu)\n",
+        BENCH_SECTOR, Simulator::erases[BENCH_SECTOR], BENCH_SECTOR + 1, Simulator::erases[BENCH_SECTOR + 1], writes);
+}
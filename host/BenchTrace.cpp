@@ -0,0 +1,95 @@
+/**
+ * @file BenchTrace.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Cost of the transition trace against a Serial print, and its
+ *        dump over MQTT
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+extern Blinds blinds;
+void loop();
+
+#define SIM_OBJECT_TRACE "/IOT3/TRACE/192.168.0.100"
+
+static std::string dump;
+
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (!strcmp(topic, SIM_OBJECT_TRACE)) dump.assign((const char*)payload, length);
+}
+
+/**
+ * @brief Host CPU and virtual time of recording a transition, then of
+ *        printing the same transition on the serial port at 9600 bauds
+ */
+static void cost() {
+    Samples cpu, print, printTime;
+    for (int i = 0; i < 100; i++) {
+        Stopwatch watch;
+        for (int j = 0; j < 1000; j++) {
+            Trace::record(j % CHANNELS, TS_MQTT, j & 1 ? BE_OPEN : BE_CLOSE, BS_CLOSED, BS_OPENING, BM_MANUAL, j % 101, 0);
+        }
+        cpu.add(watch.elapsedUs());
+    }
+    cpu.report("Trace::record() cpu", "ns");
+    Serial.begin(9600);
+    for (int i = 0; i < 1000; i++) {
+        uint64_t before = Simulator::now;
+        Stopwatch watch;
+        Serial.printf("%lu ch%d mqtt open closed->opening manual %d%%\n", millis(), i % CHANNELS, i % 101);
+        print.add(watch.elapsedUs() * 1000);
+        printTime.add((Simulator::now - before) / 1000.0);
+    }
+    print.report("Serial.printf() cpu", "ns");
+    printTime.report("Serial.printf() at 9600 bauds", "ms");
+}
+
+/**
+ * @brief Decodes the entries of a dump the way tools/trace.py does
+ */
+static bool find(uint8_t event, uint8_t from, uint8_t to, bool ignored) {
+    size_t count = (uint8_t)dump[2] | (uint8_t)dump[3] << 8;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* entry = (const uint8_t*)dump.data() + TRACE_HEADER + i * TRACE_ENTRY;
+        if ((entry[4] & 0x0f) == 0 && entry[5] == event && entry[6] == from && entry[7] == to &&
+            !(entry[10] & TF_IGNORED) == !ignored) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Sends a dump_trace after an open, an ignored open and the
+ *        end of the travel and checks that the dump tells them apart
+ */
+static void roundTrip() {
+    manual();
+    blinds.close(0);
+    loopFor(2500);
+    Simulator::onPublish = onPublish;
+    blinds.open(0);
+    blinds.open(0);
+    loopFor(2500);
+    dump.clear();
+    Simulator::inject(SIM_OBJECT_COMMANDS, "{\"cmd\":\"dump_trace\"}");
+    loopFor(100);
+    Simulator::onPublish = NULL;
+    if (dump.size() < TRACE_HEADER) {
+        printf("no dump\n");
+        return;
+    }
+    bool valid = dump[0] == 1 && dump[1] == TRACE_ENTRY &&
+        find(BE_OPEN, BS_CLOSED, BS_OPENING, false) &&
+        find(BE_OPEN, BS_OPENING, BS_OPENING, true) &&
+        find(BE_TIMEOUT, BS_OPENING, BS_OPENED, false);
+    printf("dump: %zu bytes of %d, %s\n", dump.size(), MAX_TRACE, valid ? "valid" : "INVALID");
+}
+
+void benchTrace() {
+    cost();
+    roundTrip();
+}
@@ -0,0 +1,215 @@
+/**
+ * @file BenchTravel.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Blinds slower and faster than the travel of the board, driven
+ *        with the fixed travel, with the times of a calibration over
+ *        MQTT and with end-stops: how long the servos grind at the ends
+ *        and how far from them they stop
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <math.h>
+
+extern Blinds blinds;
+void loop();
+
+/**
+ * Open and close cycles per configuration; the user calibrating over
+ * MQTT sends the stop TRAVEL_REACTION ms after the blinds reach an end
+ */
+#define TRAVEL_CYCLES   10
+#define TRAVEL_REACTION 200
+
+/**
+ * Real travel times of the blinds in ms, opening and closing: short,
+ * long, as the board says, and heavier to lift than to lower
+ */
+static const unsigned long real[][2] = {{1500, 1400}, {2600, 2300}, {2000, 2000}, {2400, 1800}};
+
+static Motor& motor(uint8_t channel) {return Simulator::motors[Board::servoPin(channel)];}
+
+/**
+ * @brief Whether a channel is travelling or its servo still coasting
+ */
+static bool moving() {
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (blinds.getState(i) == BS_OPENING || blinds.getState(i) == BS_CLOSING || motor(i).speed) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Closes every channel, then puts the blinds back at the closed
+ *        end by hand
+ */
+static void reset() {
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds.close(i);
+    while (moving()) loop();
+    for (uint8_t i = 0; i < CHANNELS; i++) motor(i).position = 0;
+}
+
+/**
+ * @brief Grinding per travel in ms and how far from the end the blinds
+ *        stopped in %, per channel
+ */
+struct Travels {
+    Samples grinding[CHANNELS];
+    Samples shortfall[CHANNELS];
+};
+
+/**
+ * @brief One travel of every channel to an end
+ *
+ * @param opening
+ * @param travels
+ */
+static void travel(bool opening, Travels& travels) {
+    uint64_t before[CHANNELS];
+    for (uint8_t i = 0; i < CHANNELS; i++) before[i] = motor(i).grinding;
+    Simulator::inject(SIM_OBJECT_COMMANDS, opening ? "{\"cmd\":\"open\"}" : "{\"cmd\":\"close\"}");
+    loopFor(100);
+    while (moving()) loop();
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        travels.grinding[i].add((motor(i).grinding - before[i]) / 1000.0);
+        travels.shortfall[i].add(100 * (opening ? 1 - motor(i).position : motor(i).position));
+    }
+}
+
+/**
+ * @brief Open and close cycles, reported per channel
+ *
+ * @param name of the configuration
+ * @param learned called after each cycle, may be null
+ */
+static void cycles(const char* name, void (*learned)(int cycle)) {
+    Travels travels;
+    for (int cycle = 0; cycle < TRAVEL_CYCLES; cycle++) {
+        travel(true, travels);
+        travel(false, travels);
+        if (learned) learned(cycle);
+    }
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        printf("%-10s ch%d real %4lu/%4lu ms, learned %4u/%4u ms: grinding %4.0f ms per travel, stopped %4.1f%% short of the end\n",
+            name, i, motor(i).opening, motor(i).closing, blinds.getTravel(i, BS_OPENING), blinds.getTravel(i, BS_CLOSING),
+            travels.grinding[i].mean(), travels.shortfall[i].mean());
+    }
+}
+
+/**
+ * @brief Calibrates every channel over MQTT, the user watching the
+ *        blinds and sending a stop whenever they reach an end
+ */
+static void calibrate() {
+    char topics[CHANNELS][MAX_TOPIC];
+    uint64_t seen[CHANNELS];
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        snprintf(topics[i], sizeof(topics[i]), "%s/%d", SIM_OBJECT_COMMANDS, i);
+        Simulator::inject(topics[i], "{\"cmd\":\"calibrate\"}");
+        seen[i] = 0;
+    }
+    loopFor(100);
+    bool calibrating = true;
+    while (calibrating) {
+        loop();
+        calibrating = false;
+        for (uint8_t i = 0; i < CHANNELS; i++) {
+            if (!blinds.isCalibrating(i)) continue;
+            calibrating = true;
+            const Motor& m = motor(i);
+            bool end = m.speed > 0 ? m.opened() : m.speed < 0 && m.closed();
+            if (!end) seen[i] = 0;
+            else if (!seen[i]) {
+                seen[i] = Simulator::now;
+                Simulator::inject(topics[i], "{\"cmd\":\"stop\"}", TRAVEL_REACTION * 1000ULL);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Learned times of every channel after each cycle with the
+ *        end-stops
+ */
+static uint16_t history[TRAVEL_CYCLES][CHANNELS][2];
+
+static void record(int cycle) {
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        history[cycle][i][0] = blinds.getTravel(i, BS_OPENING);
+        history[cycle][i][1] = blinds.getTravel(i, BS_CLOSING);
+    }
+}
+
+/**
+ * @brief With the end-stops, positions in between sent from the ends and
+ *        from each other: the switch of the end the blinds leave must not
+ *        end the travel. Reported against real position, in %
+ *
+ * @param error
+ */
+static void positions(Samples& error) {
+    static const int targets[] = {30, 60, 100, 70, 10, 0, 45, 100, 0};
+    for (int cycle = 0; cycle < TRAVEL_CYCLES; cycle++) {
+        for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+            char command[48];
+            snprintf(command, sizeof(command), "{\"cmd\":\"set_position\",\"position\":%d}", targets[t]);
+            Simulator::inject(SIM_OBJECT_COMMANDS, command);
+            loopFor(100);
+            while (moving()) loop();
+            for (uint8_t i = 0; i < CHANNELS; i++) error.add(fabs(motor(i).position * 100 - blinds.getPosition(i)));
+        }
+    }
+}
+
+/**
+ * @brief The same blinds with the fixed travel of the board, with the
+ *        times learned by a calibration over MQTT, then with end-stops
+ *        refining the times from the travel of the board
+ */
+void benchTravel() {
+    manual();
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        motor(i).opening = real[i % 4][0];
+        motor(i).closing = real[i % 4][1];
+    }
+    reset();
+    cycles("fixed", NULL);
+
+    reset();
+    calibrate();
+    cycles("calibrated", NULL);
+
+    Simulator::endStops = true;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        blinds.setTravel(i, Board::travel, Board::travel);
+        Repository::saveTravel(i, Board::travel, Board::travel);
+    }
+    reset();
+    cycles("end-stops", record);
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        printf("end-stops  ch%d learned after each cycle:", i);
+        for (int cycle = 0; cycle < TRAVEL_CYCLES; cycle++) printf(" %u/%u", history[cycle][i][0], history[cycle][i][1]);
+        uint16_t opening, closing;
+        if (!Repository::loadTravel(i, opening, closing)) opening = closing = Board::travel;
+        bool saved = abs(opening - blinds.getTravel(i, BS_OPENING)) < TRAVEL_RESOLUTION &&
+            abs(closing - blinds.getTravel(i, BS_CLOSING)) < TRAVEL_RESOLUTION;
+        printf(", %s\n", saved ? "saved" : "NOT SAVED");
+    }
+    Samples error;
+    positions(error);
+    error.report("end-stops set_position: real vs reported", "%");
+
+    /**
+     * The switches stay connected to blinds of the board's travel
+     */
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        motor(i).opening = SIM_TRAVEL;
+        motor(i).closing = SIM_TRAVEL;
+        blinds.setTravel(i, Board::travel, Board::travel);
+    }
+    reset();
+}
@@ -0,0 +1,145 @@
+/**
+ * @file Benchmark.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Helpers shared by the native simulation and benchmark suites
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+#include <algorithm>
+
+/**
+ * Firmware entry points from src/main.cpp
+ */
+void setup();
+void loop();
+extern Blinds blinds;
+extern CommandQueue commandQueue;
+
+double Samples::mean() const {
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); i++) sum += values[i];
+    return values.empty() ? 0 : sum / values.size();
+}
+
+double Samples::percentile(double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+void Samples::report(const char* name, const char* unit) {
+    printf("%-40s n=%-8zu mean=%10.3f p50=%10.3f p99=%10.3f max=%10.3f %s\n",
+        name, values.size(), mean(), percentile(50), percentile(99), percentile(100), unit);
+}
+
+void format() {
+    Repository repos;
+    repos.setSSID(DEF_SSID);
+    repos.setPassword(DEF_PASSWORD);
+    repos.setName(DEF_NAME);
+    repos.setMQTTServer(DEF_MQTT_SERVER);
+    repos.setMQTTPort(DEF_MQTT_PORT);
+    repos.save();
+}
+
+void boot() {
+    format();
+
+    /**
+     * Each end-stop of the board sits on the blinds of its channel; the
+     * switches are left disconnected until a suite connects them
+     */
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (Board::endStopPin(i) != NO_PIN) Simulator::motors[Board::servoPin(i)].endStop = Board::endStopPin(i);
+    }
+    setup();
+
+    /**
+     * The connection comes up in the background; wait for READY
+     */
+    while (Simulator::published == 0) loop();
+}
+
+bool loopUntilPublished(unsigned long count, unsigned long timeout) {
+    unsigned long target = Simulator::published + count;
+    unsigned long start = millis();
+    while (Simulator::published < target) {
+        if (millis() - start > timeout) return false;
+        loop();
+    }
+    return true;
+}
+
+void loopFor(unsigned long duration) {
+    unsigned long start = millis();
+    while (millis() - start < duration) loop();
+}
+
+static unsigned long failures = 0;
+
+void expect(bool held, const char* what) {
+    if (held) return;
+    failures++;
+    printf("FAILED: %s\n", what);
+}
+
+void manual() {
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds.setMode(i, BM_MANUAL);
+}
+
+void saturate() {
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        commandQueue.push(BC_STOP, 0, i);
+        commandQueue.push(BC_SET_MODE, BM_MANUAL, i);
+    }
+}
+
+#ifdef BENCHMARK
+
+/**
+ * @brief Benchmark suites, selectable by name on the command line
+ */
+static const struct {
+    const char* name;
+    void (*run)();
+} suites[] = {
+    {"loop", benchLoop},
+    {"setstate", benchSetState},
+    {"callback", benchCallback},
+    {"reverse", benchReverse},
+    {"storm", benchStorm},
+    {"publish", benchPublish},
+    {"query", benchQuery},
+    {"format", benchFormat},
+    {"channels", benchChannels},
+    {"storage", benchStorage},
+    {"portal", benchPortal},
+    {"metrics", benchMetrics},
+    {"trace", benchTrace},
+    {"soak", benchSoak},
+    {"power", benchPower},
+    {"photocell", benchPhotocell},
+    {"travel", benchTravel},
+    {"actuator", benchActuator},
+    {"schedule", benchSchedule},
+    {"groups", benchGroups},
+};
+
+int main(int argc, char* argv[]) {
+    Simulator::echo = false;
+    boot();
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        if (argc > 1 && strcmp(argv[1], suites[i].name)) continue;
+        printf("== %s\n", suites[i].name);
+        suites[i].run();
+    }
+    if (failures) printf("%lu bound(s) not held\n", failures);
+    return failures ? 1 : 0;
+}
+#endif
@@ -0,0 +1,125 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * @file Benchmark.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Helpers shared by the native simulation and benchmark suites
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <Simulator.h>
+#include <Portal.h>
+#include <vector>
+#include <chrono>
+
+/**
+ * Object topic of the simulated device
+ */
+#define SIM_OBJECT_COMMANDS "/IOT3/COMMANDS/192.168.0.100"
+#define SIM_HOME_COMMANDS   "/IOT3/COMMANDS"
+#define SIM_OBJECT_STATES   "/IOT3/STATES/192.168.0.100"
+
+/**
+ * @brief Collects samples and prints their distribution
+ */
+class Samples {
+    std::vector<double> values;
+public:
+    void add(double value) {values.push_back(value);}
+    void clear() {values.clear();}
+    size_t count() const {return values.size();}
+    double mean() const;
+    double percentile(double p);
+    void report(const char* name, const char* unit);
+};
+
+/**
+ * @brief Wall-clock timer for host CPU cost
+ */
+class Stopwatch {
+    std::chrono::steady_clock::time_point start;
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+    double elapsedUs() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/**
+ * @brief Writes the default values to the repository
+ */
+void format();
+
+/**
+ * @brief Formats the repository with the default values, runs the
+ *        firmware setup() so that the BlindsStub firmware is selected
+ *        and waits until it is connected to the broker
+ */
+void boot();
+
+/**
+ * @brief Runs loop() until the firmware has published count messages
+ *        or the virtual timeout has elapsed
+ *
+ * @return true if the messages were published in time
+ */
+bool loopUntilPublished(unsigned long count, unsigned long timeout);
+
+/**
+ * @brief Runs loop() for a virtual duration
+ */
+void loopFor(unsigned long duration);
+
+/**
+ * @brief Puts every channel in manual mode so that the photocell
+ *        leaves them alone
+ */
+void manual();
+
+/**
+ * @brief Fills the command queue with a stop and a manual mode for each
+ *        channel, so that the next command of another kind is dropped
+ *        before the loop drains them
+ */
+void saturate();
+
+/**
+ * @brief Records a failed bound of a suite; native_bench exits with an
+ *        error once the suites ran if any bound was not held
+ *
+ * @param held
+ * @param what the bound, printed when it was not held
+ */
+void expect(bool held, const char* what);
+
+/**
+ * Benchmark suites
+ */
+void benchLoop();
+void benchSetState();
+void benchCallback();
+void benchReverse();
+void benchStorm();
+void benchPublish();
+void benchQuery();
+void benchFormat();
+void benchChannels();
+void benchStorage();
+void benchPortal();
+void benchMetrics();
+void benchTrace();
+void benchSoak();
+void benchPower();
+void benchPhotocell();
+void benchTravel();
+void benchActuator();
+void benchSchedule();
+void benchGroups();
+
+#endif
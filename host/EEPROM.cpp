@@ -0,0 +1,44 @@
+/**
+ * @file EEPROM.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 emulated EEPROM
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <EEPROM.h>
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() : size(0), dirty(false), commits(0) {
+    memset(flash, 0xff, sizeof(flash));
+    memset(data, 0xff, sizeof(data));
+}
+
+void EEPROMClass::begin(size_t size) {
+    this->size = size < EEPROM_SECTOR_SIZE ? size : EEPROM_SECTOR_SIZE;
+    memcpy(data, flash, this->size);
+    dirty = false;
+}
+
+/**
+ * @brief Writes the RAM copy back; on the target this erases and
+ *        rewrites the whole sector
+ */
+bool EEPROMClass::commit() {
+    if (!size) return false;
+    if (!dirty) return true;
+    memcpy(flash, data, size);
+    commits++;
+    dirty = false;
+    return true;
+}
+
+bool EEPROMClass::end() {
+    bool ok = commit();
+    size = 0;
+    return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+/**
+ * @file EEPROM.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 emulated EEPROM
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+
+#define EEPROM_SECTOR_SIZE 4096
+
+/**
+ * @brief Same contract as the ESP8266 core: a RAM copy of one flash
+ *        sector, written back as a whole by commit()
+ */
+class EEPROMClass {
+    uint8_t flash[EEPROM_SECTOR_SIZE];
+    uint8_t data[EEPROM_SECTOR_SIZE];
+    size_t size;
+    bool dirty;
+public:
+    unsigned long commits;
+    EEPROMClass();
+    void begin(size_t size);
+    uint8_t read(int address) {return data[address];}
+    void write(int address, uint8_t value) {data[address] = value; dirty = true;}
+    bool commit();
+    bool end();
+    size_t length() {return size;}
+    uint8_t* getDataPtr() {dirty = true; return data;}
+
+    template <typename T> T& get(int address, T& t) {
+        memcpy((uint8_t*)&t, data + address, sizeof(T));
+        return t;
+    }
+
+    template <typename T> const T& put(int address, const T& t) {
+        memcpy(data + address, (const uint8_t*)&t, sizeof(T));
+        dirty = true;
+        return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file ESP8266WiFi.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 WiFi library
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <ESP8266WiFi.h>
+#include <Simulator.h>
+
+DEVICE_STATE ESP8266WiFiClass WiFi;
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+    return String(buf);
+}
+
+size_t IPAddress::printTo(Print& p) const {
+    return p.print(toString());
+}
+
+wl_status_t ESP8266WiFiClass::begin(const String& ssid, const String& password) {
+    beginTime = millis();
+    started = true;
+    return status();
+}
+
+/**
+ * @brief The station associates associationDelay ms after begin() or
+ *        after the simulated access point comes back
+ */
+wl_status_t ESP8266WiFiClass::status() {
+    if (!started) return WL_IDLE_STATUS;
+    if (!Simulator::wifiUp) {
+        beginTime = millis();
+        return WL_DISCONNECTED;
+    }
+    if (millis() - beginTime < Simulator::associationDelay) return WL_DISCONNECTED;
+    return WL_CONNECTED;
+}
+
+IPAddress ESP8266WiFiClass::localIP() {
+    if (status() != WL_CONNECTED) return IPAddress();
+    return IPAddress(Simulator::ip[0], Simulator::ip[1], Simulator::ip[2], Simulator::ip[3]);
+}
+
+/**
+ * @brief The broker resolves at once to the address of the simulated
+ *        network, while the station is associated
+ */
+int ESP8266WiFiClass::hostByName(const char* host, IPAddress& result, uint32_t timeout) {
+    if (status() != WL_CONNECTED) return 0;
+    result = IPAddress(Simulator::ip[0], Simulator::ip[1], Simulator::ip[2], 1);
+    return 1;
+}
+
+/**
+ * @brief The simulator accounts the time spent in delay() according
+ *        to the sleep type
+ */
+bool ESP8266WiFiClass::setSleepMode(WiFiSleepType_t type, uint8_t listenInterval) {
+    Simulator::sleepType = type;
+    Simulator::listenInterval = listenInterval ? listenInterval : 1;
+    return true;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    size_t room = availableForWrite();
+    if (size > room) size = room;
+    socket->out.append((const char*)buffer, size);
+    return size;
+}
+
+int WiFiClient::available() {
+    return socket && !socket->closed ? socket->in.size() : 0;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    size_t length = available();
+    if (size > length) size = length;
+    memcpy(buffer, socket->in.data(), size);
+    socket->in.erase(0, size);
+    return size;
+}
+
+size_t WiFiClient::availableForWrite() {
+    if (!socket || socket->closed || socket->peerClosed) return 0;
+    return socket->out.size() < TCP_WINDOW ? TCP_WINDOW - socket->out.size() : 0;
+}
+
+/**
+ * @brief Still connected while the peer is, or while it sent data that
+ *        was not read yet
+ */
+uint8_t WiFiClient::connected() {
+    return socket && !socket->closed && (!socket->peerClosed || !socket->in.empty());
+}
+
+void WiFiClient::stop() {
+    if (socket) socket->closed = true;
+    socket.reset();
+}
+
+WiFiClient WiFiServer::available() {
+    if (!started || Simulator::listening.empty()) return WiFiClient();
+    WiFiClient client(Simulator::listening.front());
+    Simulator::listening.pop_front();
+    return client;
+}
@@ -0,0 +1,122 @@
+#ifndef ESP8266WIFI_H
+#define ESP8266WIFI_H
+
+/**
+ * @file ESP8266WiFi.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 WiFi library
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <memory>
+
+struct Socket;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum {
+    WIFI_NONE_SLEEP = 0,
+    WIFI_LIGHT_SLEEP = 1,
+    WIFI_MODEM_SLEEP = 2
+} WiFiSleepType_t;
+
+class IPAddress : public Printable {
+    uint8_t address[4];
+public:
+    IPAddress() {memset(address, 0, sizeof(address));}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        address[0] = a; address[1] = b; address[2] = c; address[3] = d;
+    }
+    uint8_t operator[](int index) const {return address[index];}
+    String toString() const;
+    virtual size_t printTo(Print& p) const;
+};
+
+/**
+ * @brief TCP client; the MQTT stand-in does not need a socket. As on
+ *        the ESP8266 core, a connect to an unreachable host waits for
+ *        the timeout of the stream, 5 s unless set
+ */
+class Client : public Print {
+    unsigned long timeout;
+public:
+    Client() : timeout(5000) {}
+    virtual size_t write(uint8_t c) {return 1;}
+    using Print::write;
+    void setTimeout(unsigned long timeout) {this->timeout = timeout;}
+    unsigned long getTimeout() const {return timeout;}
+};
+
+/**
+ * @brief Device side of a simulated socket; writes never block and
+ *        take at most availableForWrite() bytes
+ */
+class WiFiClient : public Client {
+    std::shared_ptr<Socket> socket;
+public:
+    WiFiClient() {}
+    WiFiClient(const std::shared_ptr<Socket>& socket) : socket(socket) {}
+    virtual size_t write(uint8_t c) {return write(&c, 1);}
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+    int available();
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    size_t availableForWrite();
+    uint8_t connected();
+    void stop();
+    operator bool() const {return socket != nullptr;}
+};
+
+/**
+ * @brief Accepts the connections opened with Simulator::connect()
+ */
+class WiFiServer {
+    bool started;
+public:
+    WiFiServer(uint16_t port) : started(false) {}
+    void begin() {started = true;}
+    void setNoDelay(bool nodelay) {}
+    WiFiClient available();
+};
+
+class ESP8266WiFiClass {
+    WiFiMode_t wifiMode;
+    unsigned long beginTime;
+    bool started;
+public:
+    ESP8266WiFiClass() : wifiMode(WIFI_OFF), beginTime(0), started(false) {}
+    bool mode(WiFiMode_t mode) {wifiMode = mode; return true;}
+    bool hostname(const String& name) {return true;}
+    wl_status_t begin(const String& ssid, const String& password);
+    wl_status_t status();
+    bool disconnect(bool wifiOff = false) {started = false; return true;}
+    IPAddress localIP();
+    int hostByName(const char* host, IPAddress& result, uint32_t timeout);
+    bool softAP(const char* ssid, const char* psk) {wifiMode = WIFI_AP; return true;}
+    IPAddress softAPIP() {return IPAddress(192, 168, 4, 1);}
+    bool setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0);
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
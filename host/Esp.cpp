@@ -0,0 +1,70 @@
+/**
+ * @file Esp.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 system object
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <Simulator.h>
+#include <spi_flash.h>
+
+EspClass ESP;
+
+/**
+ * @brief Hardware random number on the target; deterministic here so
+ *        that simulations can be replayed
+ */
+uint32_t EspClass::random() {
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/**
+ * @brief Unique per device; derived from the simulated address
+ */
+uint32_t EspClass::getChipId() {
+    return ((uint32_t)Simulator::ip[2] << 8) | Simulator::ip[3];
+}
+
+/**
+ * @brief The heap of a device running the firmware, as measured on the
+ *        target; it does not move here
+ */
+uint32_t EspClass::getFreeHeap() {return 41000;}
+uint16_t EspClass::getMaxFreeBlockSize() {return 39000;}
+uint8_t EspClass::getHeapFragmentation() {return 5;}
+
+/**
+ * @brief Erases are atomic; nothing happens once the power is cut
+ */
+bool EspClass::flashEraseSector(uint32_t sector) {
+    if (Simulator::flashBudget == 0) return false;
+    Simulator::flash[sector].assign(SPI_FLASH_SEC_SIZE, 0xff);
+    Simulator::erases[sector]++;
+    return true;
+}
+
+/**
+ * @brief Programming can only clear bits; the write stops part way
+ *        through when the power budget runs out
+ */
+bool EspClass::flashWrite(uint32_t address, const uint32_t* data, size_t size) {
+    std::vector<uint8_t>& sector = Simulator::sector(address / SPI_FLASH_SEC_SIZE);
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        if (Simulator::flashBudget == 0) return false;
+        if (Simulator::flashBudget > 0) Simulator::flashBudget--;
+        sector[(address + i) % SPI_FLASH_SEC_SIZE] &= bytes[i];
+    }
+    return true;
+}
+
+bool EspClass::flashRead(uint32_t address, uint32_t* data, size_t size) {
+    std::vector<uint8_t>& sector = Simulator::sector(address / SPI_FLASH_SEC_SIZE);
+    for (size_t i = 0; i < size; i++) ((uint8_t*)data)[i] = sector[(address + i) % SPI_FLASH_SEC_SIZE];
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef ESP_H
+#define ESP_H
+
+/**
+ * @file Esp.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 system object
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+class EspClass {
+public:
+    uint32_t random();
+    uint32_t getChipId();
+    uint32_t getFreeHeap();
+    uint16_t getMaxFreeBlockSize();
+    uint8_t getHeapFragmentation();
+    bool flashEraseSector(uint32_t sector);
+    bool flashWrite(uint32_t address, const uint32_t* data, size_t size);
+    bool flashRead(uint32_t address, uint32_t* data, size_t size);
+};
+
+extern EspClass ESP;
+
+#endif
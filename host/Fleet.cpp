@@ -0,0 +1,440 @@
+/**
+ * @file Fleet.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Fleet of simulated devices against an in-process broker
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+#ifdef FLEET
+#include <unordered_map>
+#include <limits.h>
+
+void setup();
+void loop();
+extern Blinds blinds;
+
+/**
+ * Devices simulated by default
+ */
+#define FLEET_DEVICES 1000
+
+/**
+ * Devices take turns running FLEET_SLICE ms of virtual time. A message
+ * takes FLEET_LATENCY ms from its publisher to its subscribers, which
+ * must not be shorter than a slice so that no device receives a
+ * message from a time it has already run past
+ */
+#define FLEET_SLICE   20
+#define FLEET_LATENCY 20
+
+/**
+ * Broker throughput is reported per FLEET_BUCKET ms
+ */
+#define FLEET_BUCKET  100
+
+/**
+ * Blinds per room; a room is a group its devices join
+ */
+#define FLEET_ROOM    12
+
+/**
+ * Bounds of the section holding the state of one device
+ */
+extern char __start_iot3_device[];
+extern char __stop_iot3_device[];
+
+/**
+ * @brief A simulated device: its saved state and what the broker has
+ *        for it
+ */
+struct Device {
+    std::vector<char> image;
+    std::list<Message> deliveries;
+    std::vector<std::string> filters;
+    uint64_t commandAt;
+    bool opened;
+    unsigned long sunset;
+    uint64_t movedAt;
+};
+
+/**
+ * @brief What went through the broker during a scenario
+ */
+struct Counters {
+    unsigned long commands;
+    unsigned long deliveries;
+    unsigned long published;
+    unsigned long toController;
+    unsigned long long bytes;
+    uint64_t first;
+    uint64_t last;
+    std::map<uint64_t, unsigned long> buckets;
+    Samples latency;
+};
+
+static std::vector<Device> devices;
+static std::vector<char> pristine;
+static int current = -1;
+static uint64_t clock_ms = 0;
+static Counters counters;
+
+/**
+ * Subscriptions: exact filters, and filters ending with "/+" by prefix
+ */
+static std::unordered_map<std::string, std::vector<int> > exact;
+static std::unordered_map<std::string, std::vector<int> > children;
+static std::unordered_map<std::string, std::string> retained;
+
+static size_t imageSize() {return __stop_iot3_device - __start_iot3_device;}
+
+static void swapIn(int device) {
+    memcpy(__start_iot3_device, devices[device].image.data(), imageSize());
+    current = device;
+}
+
+static void swapOut() {
+    memcpy(devices[current].image.data(), __start_iot3_device, imageSize());
+    current = -1;
+}
+
+/**
+ * @brief Counts a message reaching the broker
+ */
+static void receive(uint64_t at, size_t length) {
+    if (counters.buckets.empty()) counters.first = at;
+    counters.last = at;
+    counters.buckets[at / (FLEET_BUCKET * 1000)]++;
+    counters.bytes += length;
+}
+
+static void deliver(int device, uint64_t at, const std::string& topic, const std::string& payload) {
+    Message message;
+    message.at = at + FLEET_LATENCY * 1000ULL;
+    message.topic = topic;
+    message.payload = payload;
+    devices[device].deliveries.push_back(message);
+    counters.deliveries++;
+    counters.bytes += payload.size();
+}
+
+/**
+ * @brief Hands a message to every device subscribed to its topic
+ */
+static void route(uint64_t at, const std::string& topic, const std::string& payload) {
+    std::unordered_map<std::string, std::vector<int> >::iterator found = exact.find(topic);
+    if (found != exact.end()) {
+        for (size_t i = 0; i < found->second.size(); i++) deliver(found->second[i], at, topic, payload);
+    }
+    size_t slash = topic.rfind('/');
+    if (slash == std::string::npos) return;
+    found = children.find(topic.substr(0, slash));
+    if (found != children.end()) {
+        for (size_t i = 0; i < found->second.size(); i++) deliver(found->second[i], at, topic, payload);
+    }
+}
+
+/**
+ * @brief A message published by the device running
+ */
+static void onPublish(const char* topic, const uint8_t* payload, unsigned int length, bool retain) {
+    std::string name(topic), body((const char*)payload, length);
+    receive(Simulator::now, length);
+    counters.published++;
+    if (retain) retained[name] = body;
+
+    /**
+     * The controller subscribes to /IOT3/STATES and /IOT3/STATES/#
+     */
+    if (!name.compare(0, 12, "/IOT3/STATES")) {
+        counters.toController++;
+        counters.bytes += length;
+    }
+    Device& device = devices[current];
+    if (device.commandAt && name.size() > 12 && !name.compare(0, 13, "/IOT3/STATES/")) {
+        counters.latency.add((Simulator::now - device.commandAt) / 1000.0);
+        device.commandAt = 0;
+    }
+    route(Simulator::now, name, body);
+}
+
+static void unsubscribe(std::unordered_map<std::string, std::vector<int> >& table, const std::string& filter) {
+    std::vector<int>& subscribers = table[filter];
+    for (size_t i = 0; i < subscribers.size(); i++) {
+        if (subscribers[i] != current) continue;
+        subscribers[i] = subscribers.back();
+        subscribers.pop_back();
+        break;
+    }
+}
+
+/**
+ * @brief A subscription of the device running; NULL starts a clean
+ *        session
+ */
+static void onSubscribe(const char* filter) {
+    Device& device = devices[current];
+    if (filter == NULL) {
+        for (size_t i = 0; i < device.filters.size(); i++) {
+            const std::string& name = device.filters[i];
+            if (name.size() > 2 && !name.compare(name.size() - 2, 2, "/+")) unsubscribe(children, name.substr(0, name.size() - 2));
+            else unsubscribe(exact, name);
+        }
+        device.filters.clear();
+        return;
+    }
+    std::string name(filter);
+    device.filters.push_back(name);
+    if (name.size() > 2 && !name.compare(name.size() - 2, 2, "/+")) children[name.substr(0, name.size() - 2)].push_back(current);
+    else exact[name].push_back(current);
+}
+
+/**
+ * @brief The controller publishes a command, possibly later in the
+ *        slice or after it
+ */
+static void command(const std::string& topic, const char* payload, uint64_t delay = 0) {
+    uint64_t at = clock_ms * 1000 + delay;
+    receive(at, strlen(payload));
+    counters.commands++;
+    route(at, topic, payload);
+}
+
+static std::string objectTopic(int device) {
+    char topic[MAX_TOPIC];
+    snprintf(topic, sizeof(topic), "/IOT3/COMMANDS/10.0.%d.%d", (device + 1) >> 8, (device + 1) & 0xff);
+    return topic;
+}
+
+/**
+ * @brief Creates the devices from the state the program started with,
+ *        each with its own address and flash
+ */
+static void create(int count) {
+    pristine.assign(__start_iot3_device, __stop_iot3_device);
+    devices.resize(count);
+    for (int i = 0; i < count; i++) {
+        devices[i].image = pristine;
+        devices[i].commandAt = 0;
+        devices[i].opened = false;
+        devices[i].sunset = ULONG_MAX;
+        devices[i].movedAt = 0;
+        swapIn(i);
+        Simulator::ip[0] = 10;
+        Simulator::ip[1] = 0;
+        Simulator::ip[2] = (i + 1) >> 8;
+        Simulator::ip[3] = (i + 1) & 0xff;
+        format();
+        setup();
+        swapOut();
+    }
+}
+
+/**
+ * @brief Runs every device up to a virtual time, one slice at a time;
+ *        the workload is called at the start of each slice
+ */
+static void run(unsigned long duration, void (*workload)(uint64_t start)) {
+    uint64_t until = clock_ms + duration;
+    while (clock_ms < until) {
+        if (workload) workload(clock_ms);
+        uint64_t end = (clock_ms + FLEET_SLICE) * 1000;
+        for (size_t i = 0; i < devices.size(); i++) {
+            Device& device = devices[i];
+            swapIn(i);
+            while (!device.deliveries.empty() && device.deliveries.front().at < end) {
+                Simulator::inbox.push_back(device.deliveries.front());
+                device.deliveries.pop_front();
+            }
+            Simulator::light = clock_ms >= device.sunset ? 0 : 1023;
+            while (Simulator::now < end) {
+                loop();
+                BlindsState state = blinds.getState(0);
+                if (!device.movedAt && (state == BS_OPENING || state == BS_CLOSING)) device.movedAt = Simulator::now;
+            }
+            swapOut();
+        }
+        clock_ms += FLEET_SLICE;
+    }
+}
+
+static void report(const char* scenario) {
+    unsigned long peak = 0;
+    for (std::map<uint64_t, unsigned long>::iterator i = counters.buckets.begin(); i != counters.buckets.end(); i++) {
+        if (i->second > peak) peak = i->second;
+    }
+    printf("%-9s commands=%-6lu deliveries=%-7lu published=%-7lu to_controller=%-7lu peak=%lu/%dms span=%.0fms bytes=%llu\n",
+        scenario, counters.commands, counters.deliveries, counters.published, counters.toController,
+        peak, FLEET_BUCKET, (counters.last - counters.first) / 1000.0, counters.bytes);
+    if (counters.latency.count()) counters.latency.report("  command-to-state latency", "ms");
+    counters = Counters();
+}
+
+/**
+ * Workloads
+ */
+static uint64_t workloadStart;
+static unsigned long commandRate;
+
+static void broadcastQuery(uint64_t start) {
+    if (start == workloadStart) command("/IOT3/COMMANDS", "{\"cmd\":\"query_objects\"}");
+}
+
+static void openClose(uint64_t start) {
+    unsigned long count = commandRate * FLEET_SLICE / 1000;
+    for (unsigned long i = 0; i < count; i++) {
+        int target = random(devices.size());
+        Device& device = devices[target];
+        device.opened = !device.opened;
+        if (!device.commandAt) device.commandAt = start * 1000;
+        command(objectTopic(target), device.opened ? "{\"cmd\":\"open\"}" : "{\"cmd\":\"close\"}");
+    }
+}
+
+static void modeFlip(uint64_t start) {
+    if (start != workloadStart) return;
+    for (size_t i = 0; i < devices.size(); i++) command(objectTopic(i), "{\"cmd\":\"set_mode\",\"mode\":2}");
+}
+
+static std::string room(size_t device) {
+    char name[MAX_TOPIC];
+    snprintf(name, sizeof(name), "room%zu", device / FLEET_ROOM);
+    return name;
+}
+
+static std::string roomTopic(size_t device) {
+    return "/IOT3/GROUPS/" + room(device);
+}
+
+/**
+ * @brief Every device joins the group of its room, then each room is
+ *        put in manual mode on the group topic
+ */
+static void joinRooms(uint64_t start) {
+    if (start == workloadStart) {
+        for (size_t i = 0; i < devices.size(); i++) {
+            std::string payload = "{\"cmd\":\"join\",\"group\":\"" + room(i) + "\"}";
+            command(objectTopic(i), payload.c_str());
+        }
+    }
+    if (start != workloadStart + 1000) return;
+    for (size_t i = 0; i < devices.size(); i += FLEET_ROOM) command(roomTopic(i), "{\"cmd\":\"set_mode\",\"mode\":1}");
+}
+
+/**
+ * @brief The controller opens every room one blind at a time, at the
+ *        command rate
+ */
+static void openBlinds(uint64_t start) {
+    if (start != workloadStart) return;
+    uint64_t gap = 1000000 / commandRate;
+    for (size_t i = 0; i < devices.size(); i++) command(objectTopic(i), "{\"cmd\":\"open\"}", i * gap);
+}
+
+/**
+ * @brief The controller closes every room with one message, at the
+ *        command rate
+ */
+static void closeRooms(uint64_t start) {
+    if (start != workloadStart) return;
+    uint64_t gap = 1000000 / commandRate;
+    for (size_t i = 0; i < devices.size(); i += FLEET_ROOM) command(roomTopic(i), "{\"cmd\":\"close\"}", i / FLEET_ROOM * gap);
+}
+
+/**
+ * @brief Spread of the start of the blinds of each room, from the first
+ *        to start to the last
+ */
+static void spread(const char* scenario) {
+    Samples rooms;
+    unsigned long still = 0;
+    for (size_t first = 0; first < devices.size(); first += FLEET_ROOM) {
+        uint64_t earliest = ULLONG_MAX, latest = 0;
+        for (size_t i = first; i < first + FLEET_ROOM && i < devices.size(); i++) {
+            uint64_t at = devices[i].movedAt;
+            devices[i].movedAt = 0;
+            if (!at) {
+                still++;
+                continue;
+            }
+            if (at < earliest) earliest = at;
+            if (at > latest) latest = at;
+        }
+        if (latest) rooms.add((latest - earliest) / 1000.0);
+    }
+    printf("  %s: %zu rooms of %d, %lu blinds did not move\n", scenario, (size_t)rooms.count(), FLEET_ROOM, still);
+    rooms.report("  start spread in a room", "ms");
+}
+
+/**
+ * @brief Boots the fleet, then runs the workloads one after the other
+ *        and reports what went through the broker for each
+ *
+ * Usage: program [devices] [commands per second]
+ */
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : FLEET_DEVICES;
+    commandRate = argc > 2 ? strtoul(argv[2], NULL, 10) : 100;
+    Simulator::echo = false;
+    Simulator::onPublish = onPublish;
+    Simulator::onSubscribe = onSubscribe;
+    Stopwatch watch;
+    create(count);
+    printf("devices=%d state=%zu bytes each, slice=%dms latency=%dms\n", count, imageSize(), FLEET_SLICE, FLEET_LATENCY);
+
+    run(5000, NULL);
+    report("boot");
+
+    workloadStart = clock_ms;
+    run(4000, broadcastQuery);
+    report("query");
+
+    workloadStart = clock_ms;
+    run(10000, openClose);
+    run(3000, NULL);
+    report("commands");
+
+    workloadStart = clock_ms;
+    run(4000, modeFlip);
+    report("modes");
+
+    /**
+     * Sunset sweeps the fleet over a minute; each photocell then waits
+     * for its dwell time before closing
+     */
+    for (size_t i = 0; i < devices.size(); i++) devices[i].sunset = clock_ms + random(60000);
+    run(100000, NULL);
+    report("sunset");
+
+    /**
+     * Rooms opened one blind at a time, then closed with a message per
+     * room on the topic of its group
+     */
+    workloadStart = clock_ms;
+    run(3000, joinRooms);
+    report("join");
+    for (size_t i = 0; i < devices.size(); i++) devices[i].movedAt = 0;
+    workloadStart = clock_ms;
+    run(devices.size() * 1000 / commandRate + 3000, openBlinds);
+    report("blinds");
+    spread("one message per blind");
+    workloadStart = clock_ms;
+    run(devices.size() / FLEET_ROOM * 1000 / commandRate + 3000, closeRooms);
+    report("rooms");
+    spread("one message per room");
+
+    size_t subscriptions = 0, bytes = 0;
+    for (size_t i = 0; i < devices.size(); i++) subscriptions += devices[i].filters.size();
+    for (std::unordered_map<std::string, std::string>::iterator i = retained.begin(); i != retained.end(); i++) {
+        bytes += i->first.size() + i->second.size();
+    }
+    printf("broker: subscriptions=%zu retained=%zu topics, %zu bytes\n", subscriptions, retained.size(), bytes);
+    printf("host time %.1f s for %.0f s of fleet time\n", watch.elapsedUs() / 1e6, clock_ms / 1000.0);
+    return 0;
+}
+#endif
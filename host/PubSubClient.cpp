@@ -0,0 +1,93 @@
+/**
+ * @file PubSubClient.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the PubSubClient MQTT library
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <PubSubClient.h>
+#include <Simulator.h>
+
+/**
+ * @brief A new session starts without subscriptions, like a clean
+ *        session on a real broker. A broker that is down is taken as
+ *        unreachable: the TCP handshake blocks for the timeout of the
+ *        client
+ */
+bool PubSubClient::connect(const char* id) {
+    session = WiFi.status() == WL_CONNECTED && Simulator::brokerUp;
+    if (WiFi.status() == WL_CONNECTED && !Simulator::brokerUp) Simulator::advance((uint64_t)client.getTimeout() * 1000);
+    subscriptions.clear();
+    if (session && Simulator::onSubscribe) Simulator::onSubscribe(NULL);
+    lastState = session ? MQTT_CONNECTED : MQTT_CONNECT_FAILED;
+    return session;
+}
+
+void PubSubClient::disconnect() {
+    session = false;
+    lastState = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+    if (session && (WiFi.status() != WL_CONNECTED || !Simulator::brokerUp)) {
+        session = false;
+        lastState = MQTT_CONNECTION_LOST;
+    }
+    return session;
+}
+
+/**
+ * @brief Delivers at most one queued message per call, as the real
+ *        client reads at most one packet per loop(); a station in light
+ *        sleep only gets it once it has listened to the access point
+ */
+bool PubSubClient::loop() {
+    if (!connected()) return false;
+    if (Simulator::inbox.empty() || Simulator::heard(Simulator::inbox.front().at) > Simulator::now) return true;
+    Message message = std::move(Simulator::inbox.front());
+    Simulator::inbox.pop_front();
+    for (size_t i = 0; i < subscriptions.size(); i++) {
+        if (Simulator::matches(subscriptions[i].c_str(), message.topic.c_str())) {
+            if (callback) callback((char*)message.topic.c_str(), (uint8_t*)message.payload.data(), message.payload.size());
+            break;
+        }
+    }
+    return true;
+}
+
+bool PubSubClient::publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (!connected()) return false;
+
+    /**
+     * Like the library, a packet that does not fit the buffer is not sent
+     */
+    if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length > bufferSize) return false;
+    Simulator::published++;
+    if (Simulator::onPublish) Simulator::onPublish(topic, payload, length, retained);
+    return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    if (!connected()) return false;
+    subscriptions.push_back(topic);
+    if (Simulator::onSubscribe) Simulator::onSubscribe(topic);
+    return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+    for (size_t i = 0; i < subscriptions.size(); i++) {
+        if (subscriptions[i] == topic) {
+            subscriptions.erase(subscriptions.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+#ifndef PUBSUBCLIENT_H
+#define PUBSUBCLIENT_H
+
+/**
+ * @file PubSubClient.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the PubSubClient MQTT library
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <vector>
+
+#define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
+
+#define MQTT_CONNECTION_LOST   -3
+#define MQTT_CONNECT_FAILED    -2
+#define MQTT_DISCONNECTED      -1
+#define MQTT_CONNECTED          0
+
+#define MQTT_MAX_HEADER_SIZE    5
+#define MQTT_MAX_PACKET_SIZE    256
+#define MQTT_KEEPALIVE          15
+
+/**
+ * @brief MQTT client talking to the broker held by the Simulator
+ */
+class PubSubClient {
+    Client& client;
+    MQTT_CALLBACK_SIGNATURE;
+    std::vector<std::string> subscriptions;
+    bool session;
+    int lastState;
+    uint16_t bufferSize;
+    uint16_t keepAlive;
+public:
+    PubSubClient(Client& client) : client(client), callback(NULL), session(false), lastState(MQTT_DISCONNECTED),
+        bufferSize(MQTT_MAX_PACKET_SIZE), keepAlive(MQTT_KEEPALIVE) {}
+    PubSubClient& setServer(const char* domain, uint16_t port) {return *this;}
+    PubSubClient& setServer(IPAddress ip, uint16_t port) {return *this;}
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) {this->callback = callback; return *this;}
+    PubSubClient& setSocketTimeout(uint16_t timeout) {return *this;}
+    PubSubClient& setKeepAlive(uint16_t keepAlive) {this->keepAlive = keepAlive; return *this;}
+    bool setBufferSize(uint16_t size) {bufferSize = size; return size > 0;}
+    uint16_t getBufferSize() {return bufferSize;}
+    bool connect(const char* id);
+    void disconnect();
+    bool connected();
+    bool loop();
+    bool publish(const char* topic, const char* payload) {return publish(topic, payload, false);}
+    bool publish(const char* topic, const char* payload, bool retained);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {return publish(topic, payload, length, false);}
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+    bool subscribe(const char* topic);
+    bool unsubscribe(const char* topic);
+    int state() {return lastState;}
+};
+
+#endif
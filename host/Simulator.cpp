@@ -0,0 +1,204 @@
+/**
+ * @file Simulator.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Controls of the simulated board used by the native build
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Simulator.h>
+#include <ESP8266WiFi.h>
+#include <spi_flash.h>
+#include <math.h>
+
+DEVICE_STATE uint64_t Simulator::now = 0;
+bool Simulator::echo = true;
+DEVICE_STATE int Simulator::light = 1023;
+int (*Simulator::lightTrace)(unsigned long ms) = NULL;
+DEVICE_STATE bool Simulator::wifiUp = true;
+DEVICE_STATE unsigned long Simulator::associationDelay = 1500;
+DEVICE_STATE uint8_t Simulator::ip[4] = {192, 168, 0, 100};
+time_t Simulator::epoch = 1750000000;
+bool Simulator::sntpUp = true;
+DEVICE_STATE bool Simulator::synced = false;
+DEVICE_STATE bool Simulator::brokerUp = true;
+DEVICE_STATE std::list<Message> Simulator::inbox;
+PublishHook Simulator::onPublish = NULL;
+SubscribeHook Simulator::onSubscribe = NULL;
+DEVICE_STATE unsigned long Simulator::published = 0;
+DEVICE_STATE uint8_t Simulator::sleepType = WIFI_MODEM_SLEEP;
+DEVICE_STATE uint8_t Simulator::listenInterval = 1;
+DEVICE_STATE Energy Simulator::energy = {0, 0, 0};
+DEVICE_STATE std::map<uint32_t, std::vector<uint8_t> > Simulator::flash;
+DEVICE_STATE std::map<uint32_t, unsigned long> Simulator::erases;
+DEVICE_STATE long Simulator::flashBudget = -1;
+DEVICE_STATE Motor Simulator::motors[SIM_PINS];
+DEVICE_STATE bool Simulator::endStops = false;
+std::vector<Pulse> Simulator::waveform;
+bool Simulator::recording = false;
+std::deque<std::shared_ptr<Socket> > Simulator::listening;
+
+/**
+ * @brief Move the virtual clock forward
+ *
+ * @param us microseconds
+ */
+void Simulator::advance(uint64_t us) {
+    now += us;
+    for (int i = 0; i < SIM_PINS; i++) {
+        Motor& motor = motors[i];
+        if (motor.speed == 0) continue;
+        bool opening = motor.speed > 0;
+        double travel = (opening ? motor.opening : motor.closing) * 1000.0 / fabs(motor.speed);
+        double room = (opening ? 1 - motor.position : motor.position) * travel;
+        if (us > room) {
+            motor.grinding += us - room;
+            motor.position = opening ? 1 : 0;
+        }
+        else motor.position += (opening ? us : -(double)us) / travel;
+    }
+}
+
+/**
+ * @brief The waveform generator is given a pin; the servo on it turns
+ *        at the speed of the pulse, or stops without pulses
+ *
+ * @param pin
+ * @param high pulse in us, 0 to stop the waveform
+ * @param low rest of the period in us
+ */
+void Simulator::pulse(uint8_t pin, uint32_t high, uint32_t low) {
+    if (recording) waveform.push_back(Pulse{now, pin, high, low});
+    if (pin >= SIM_PINS) return;
+    double speed = high ? ((double)high - SIM_NEUTRAL) / SIM_SPAN : 0;
+    motors[pin].speed = speed > 1 ? 1 : speed < -1 ? -1 : speed;
+}
+
+/**
+ * @brief Level of a digital input: a connected end-stop grounds its
+ *        pin while its blinds are at an end, anything else reads high
+ *
+ * @param pin
+ * @return int LOW or HIGH
+ */
+int Simulator::input(uint8_t pin) {
+    if (!endStops) return HIGH;
+    for (int i = 0; i < SIM_PINS; i++) {
+        const Motor& motor = motors[i];
+        if (motor.endStop == pin && (motor.closed() || motor.opened())) return LOW;
+    }
+    return HIGH;
+}
+
+/**
+ * @brief Time spent by the firmware in delay(); the station keeps its
+ *        receiver on unless it sleeps, and then only listens to the
+ *        beacons it was told to. In light sleep the CPU stops too,
+ *        except to wake up
+ *
+ * @param us microseconds
+ */
+void Simulator::idle(uint64_t us) {
+    uint64_t interval = (uint64_t)SIM_BEACON * listenInterval;
+    uint64_t listening = ((now + us) / interval - now / interval) * SIM_LISTEN;
+    if (listening > us) listening = us;
+    switch (sleepType) {
+        case WIFI_NONE_SLEEP:
+            energy.radio += us;
+            break;
+        case WIFI_MODEM_SLEEP:
+            energy.radio += listening;
+            break;
+        case WIFI_LIGHT_SLEEP:
+            energy.radio += listening;
+            if (us > SIM_WAKE + listening) energy.asleep += us - SIM_WAKE - listening;
+            energy.wakeups++;
+            break;
+    }
+    advance(us);
+}
+
+/**
+ * @brief When a station gets a frame sent to it at a given time; one
+ *        in light sleep gets it with the next beacon it listens to. The
+ *        same wait in modem sleep, 102 ms at most, is left out so that
+ *        the other suites keep measuring the firmware alone
+ *
+ * @param at
+ * @return uint64_t
+ */
+uint64_t Simulator::heard(uint64_t at) {
+    if (sleepType != WIFI_LIGHT_SLEEP) return at;
+    uint64_t interval = (uint64_t)SIM_BEACON * listenInterval;
+    return (at + interval - 1) / interval * interval;
+}
+
+/**
+ * @brief Get a flash sector; sectors never written read as erased
+ *
+ * @param sector
+ * @return std::vector<uint8_t>&
+ */
+std::vector<uint8_t>& Simulator::sector(uint32_t sector) {
+    std::vector<uint8_t>& data = flash[sector];
+    if (data.empty()) data.assign(SPI_FLASH_SEC_SIZE, 0xff);
+    return data;
+}
+
+/**
+ * @brief Queue a message as if the broker had received it from a
+ *        controller; it is delivered by the first client.loop() that
+ *        runs once delay microseconds have elapsed
+ *
+ * @param topic
+ * @param payload
+ * @param delay
+ */
+void Simulator::inject(const char* topic, const char* payload, uint64_t delay) {
+    inject(topic, (const uint8_t*)payload, strlen(payload), delay);
+}
+
+void Simulator::inject(const char* topic, const uint8_t* payload, unsigned int length, uint64_t delay) {
+    Message message;
+    message.at = now + delay;
+    message.topic = topic;
+    message.payload.assign((const char*)payload, length);
+    inbox.push_back(message);
+}
+
+/**
+ * @brief MQTT topic filter matching with '+' and '#' wildcards
+ *
+ * @param filter
+ * @param topic
+ * @return true
+ * @return false
+ */
+bool Simulator::matches(const char* filter, const char* topic) {
+    while (*filter) {
+        if (*filter == '#') return true;
+        if (*filter == '+') {
+            while (*topic && *topic != '/') topic++;
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) return false;
+        filter++;
+        topic++;
+    }
+    return *topic == 0;
+}
+
+/**
+ * @brief Opens a connection to the device
+ *
+ * @return std::shared_ptr<Socket> the peer side
+ */
+std::shared_ptr<Socket> Simulator::connect() {
+    std::shared_ptr<Socket> socket(new Socket());
+    listening.push_back(socket);
+    return socket;
+}
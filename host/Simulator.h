@@ -0,0 +1,216 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+/**
+ * @file Simulator.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Controls of the simulated board used by the native build
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Called for every message the firmware publishes
+ */
+typedef void (*PublishHook)(const char* topic, const uint8_t* payload, unsigned int length, bool retained);
+
+/**
+ * Called with each topic filter subscribed to, and with NULL when a
+ * new session drops the previous subscriptions
+ */
+typedef void (*SubscribeHook)(const char* filter);
+
+/**
+ * @brief Message waiting to be delivered to the firmware by the broker
+ */
+struct Message {
+    uint64_t at;
+    std::string topic;
+    std::string payload;
+};
+
+/**
+ * Device send buffer (two segments, as lwIP on the ESP8266)
+ */
+#define TCP_WINDOW 2920
+
+/**
+ * @brief TCP connection between a simulated peer and the device; in
+ *        holds what the peer sent and the device has not read yet, out
+ *        what the device wrote and the peer has not read yet
+ */
+struct Socket {
+    std::string in;
+    std::string out;
+    bool peerClosed;
+    bool closed;
+    Socket() : peerClosed(false), closed(false) {}
+};
+
+/**
+ * Power model: the access point beacons every SIM_BEACON us and a
+ * station listens SIM_LISTEN us each time it wakes for one; leaving
+ * light sleep and running the pass that follows takes SIM_WAKE us
+ */
+#define SIM_BEACON 102400
+#define SIM_LISTEN 2000
+#define SIM_WAKE   1000
+
+/**
+ * Blinds model: a continuous rotation servo stands still on a pulse of
+ * SIM_NEUTRAL us and its speed grows linearly up to full speed SIM_SPAN
+ * us away, the longer pulses opening. A motor not told otherwise takes
+ * SIM_TRAVEL ms from one end to the other at full speed. An end-stop
+ * closes over the last SIM_END_STOP ms of travel
+ */
+#define SIM_PINS     17
+#define SIM_NEUTRAL  1500
+#define SIM_SPAN     500
+#define SIM_TRAVEL   2000
+#define SIM_END_STOP 1
+
+/**
+ * @brief Waveform given to the generator for a pin from a point in
+ *        time on; both times at 0 stop it
+ */
+struct Pulse {
+    uint64_t at;
+    uint8_t pin;
+    uint32_t high;
+    uint32_t low;
+};
+
+/**
+ * @brief Blinds driven by the servo on one pin; the position goes from
+ *        0 (closed) to 1 (opened), the speed from -1 (closing at full
+ *        speed) to 1, and driving them past an end grinds the gears
+ */
+struct Motor {
+    double speed;
+    double position;
+    unsigned long opening;
+    unsigned long closing;
+    int endStop;
+    uint64_t grinding;
+    Motor() : speed(0), position(0), opening(SIM_TRAVEL), closing(SIM_TRAVEL), endStop(-1), grinding(0) {}
+    bool closed() const {return position * closing <= SIM_END_STOP;}
+    bool opened() const {return (1 - position) * opening <= SIM_END_STOP;}
+};
+
+/**
+ * @brief Where the time spent in delay() went, in microseconds; the
+ *        CPU is awake the rest of the time
+ */
+struct Energy {
+    uint64_t asleep;
+    uint64_t radio;
+    unsigned long wakeups;
+};
+
+/**
+ * @brief Everything outside the firmware: the clock, the light, the
+ *        access point and the MQTT broker. The stand-in libraries read
+ *        their inputs from here and report their outputs here.
+ */
+class Simulator {
+public:
+
+    /**
+     * Virtual time in microseconds
+     */
+    static uint64_t now;
+
+    /**
+     * Serial output is echoed to stdout when set
+     */
+    static bool echo;
+
+    /**
+     * Photocell reading, or a light trace indexed by virtual milliseconds
+     */
+    static int light;
+    static int (*lightTrace)(unsigned long ms);
+
+    /**
+     * Access point; association completes associationDelay ms after
+     * WiFi.begin() while wifiUp is set
+     */
+    static bool wifiUp;
+    static unsigned long associationDelay;
+    static uint8_t ip[4];
+
+    /**
+     * Wall clock at the start of the virtual time, given by SNTP while
+     * sntpUp is set; synced tells that the device got it
+     */
+    static time_t epoch;
+    static bool sntpUp;
+    static bool synced;
+
+    /**
+     * Broker
+     */
+    static bool brokerUp;
+    static std::list<Message> inbox;
+    static PublishHook onPublish;
+    static SubscribeHook onSubscribe;
+    static unsigned long published;
+
+    /**
+     * Sleep type and listen interval asked by the firmware, and the
+     * energy accounted since the last reset of the counters
+     */
+    static uint8_t sleepType;
+    static uint8_t listenInterval;
+    static Energy energy;
+
+    /**
+     * Flash sectors and their erase counts; flashBudget is the number
+     * of bytes that can still be programmed before the power is cut,
+     * negative for no limit
+     */
+    static std::map<uint32_t, std::vector<uint8_t> > flash;
+    static std::map<uint32_t, unsigned long> erases;
+    static long flashBudget;
+
+    /**
+     * Blinds on the servo pins; the end-stops wired to the motors only
+     * reach the firmware while endStops is set
+     */
+    static Motor motors[SIM_PINS];
+    static bool endStops;
+
+    /**
+     * Waveforms given to the generator, kept while recording is set
+     */
+    static std::vector<Pulse> waveform;
+    static bool recording;
+
+    /**
+     * Connections waiting to be accepted by a WiFiServer
+     */
+    static std::deque<std::shared_ptr<Socket> > listening;
+
+    static void advance(uint64_t us);
+    static void idle(uint64_t us);
+    static uint64_t heard(uint64_t at);
+    static void pulse(uint8_t pin, uint32_t high, uint32_t low);
+    static int input(uint8_t pin);
+    static std::vector<uint8_t>& sector(uint32_t sector);
+    static void inject(const char* topic, const char* payload, uint64_t delay = 0);
+    static void inject(const char* topic, const uint8_t* payload, unsigned int length, uint64_t delay = 0);
+    static bool matches(const char* filter, const char* topic);
+    static std::shared_ptr<Socket> connect();
+};
+
+#endif
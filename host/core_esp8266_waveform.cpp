@@ -0,0 +1,24 @@
+/**
+ * @file core_esp8266_waveform.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the waveform generator of the ESP8266 core;
+ *        the waveforms go to the simulator, which records them
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <core_esp8266_waveform.h>
+#include <Simulator.h>
+
+int startWaveform(uint8_t pin, uint32_t timeHighUS, uint32_t timeLowUS, uint32_t runTimeUS) {
+    Simulator::pulse(pin, timeHighUS, timeLowUS);
+    return true;
+}
+
+int stopWaveform(uint8_t pin) {
+    Simulator::pulse(pin, 0, 0);
+    return true;
+}
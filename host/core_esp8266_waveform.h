@@ -0,0 +1,20 @@
+#ifndef CORE_ESP8266_WAVEFORM_H
+#define CORE_ESP8266_WAVEFORM_H
+
+/**
+ * @file core_esp8266_waveform.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the waveform generator of the ESP8266 core
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Arduino.h>
+
+int startWaveform(uint8_t pin, uint32_t timeHighUS, uint32_t timeLowUS, uint32_t runTimeUS = 0);
+int stopWaveform(uint8_t pin);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file main.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Entry point of the native simulation
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <Benchmark.h>
+
+#if !defined(BENCHMARK) && !defined(FLEET)
+
+void loop();
+
+/**
+ * Length of the simulation in virtual milliseconds
+ */
+#define SIM_DURATION 60000
+
+/**
+ * @brief Scripted inputs; each step is applied once the virtual clock
+ *        reaches its time
+ */
+static const struct {
+    unsigned long time;
+    const char* topic;
+    const char* payload;
+    int light;
+    int broker;
+} script[] = {
+    { 5000, SIM_OBJECT_COMMANDS, "{\"cmd\":\"open\"}", -1, -1},
+    {10000, SIM_OBJECT_COMMANDS, "{\"cmd\":\"close\"}", -1, -1},
+    {15000, SIM_HOME_COMMANDS, "{\"cmd\":\"query_objects\"}", -1, -1},
+    {20000, SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_mode\",\"mode\":2}", -1, -1},
+    {22000, SIM_OBJECT_COMMANDS, "{\"cmd\":\"set_photocell\",\"night\":150,\"day\":200,\"dwell\":5}", -1, -1},
+    {28000, NULL, NULL, -1, 0},
+    {30000, NULL, NULL, 0, -1},
+    {36000, NULL, NULL, -1, 1},
+    {45000, NULL, NULL, 1023, -1},
+};
+
+static void print(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    printf("[%8lu] %s %.*s\n", millis(), topic, (int)length, (const char*)payload);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long duration = argc > 1 ? strtoul(argv[1], NULL, 10) : SIM_DURATION;
+    size_t step = 0;
+    Simulator::onPublish = print;
+    boot();
+    while (millis() < duration) {
+        while (step < sizeof(script) / sizeof(script[0]) && millis() >= script[step].time) {
+            if (script[step].topic) Simulator::inject(script[step].topic, script[step].payload);
+            if (script[step].light >= 0) Simulator::light = script[step].light;
+            if (script[step].broker >= 0) Simulator::brokerUp = script[step].broker;
+            step++;
+        }
+        loop();
+    }
+    return 0;
+}
+#endif
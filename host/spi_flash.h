@@ -0,0 +1,17 @@
+#ifndef SPI_FLASH_H
+#define SPI_FLASH_H
+
+/**
+ * @file spi_flash.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Linux stand-in for the ESP8266 SDK flash definitions
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file Actuator.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Servo driven by the waveform generator, with speed ramps
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <core_esp8266_waveform.h>
+
+/**
+ * @brief Construct a new Actuator:: Actuator object
+ */
+Actuator::Actuator() : pin(NO_PIN), speed(0), target(0), running(false), sampled(0), distance(0) {}
+
+/**
+ * @brief Give the actuator its pin; nothing is sent until it is driven
+ *
+ * @param pin
+ */
+void Actuator::attach(uint8_t pin) {
+    this->pin = pin;
+    sampled = millis();
+}
+
+/**
+ * @brief Adds the distance run at the current speed since the last
+ *        sample
+ *
+ * @param now in ms
+ */
+void Actuator::advance(unsigned long now) {
+    distance += (long)speed * (long)(now - sampled);
+    sampled = now;
+}
+
+/**
+ * @brief Moves the speed towards the target by what the elapsed time
+ *        allows, so that a late step catches up instead of stretching
+ *        the ramp. A reversal slows down to a standstill first
+ *
+ * @param elapsed in ms since the previous step
+ */
+void Actuator::slew(unsigned long elapsed) {
+    if (speed == target) return;
+    bool slowing = (speed > 0 && target < speed) || (speed < 0 && target > speed);
+    unsigned long ramp = slowing ? ACTUATOR_DECELERATION : ACTUATOR_ACCELERATION;
+    long change = ramp ? (long)(ACTUATOR_FULL * elapsed / ramp) : 2 * ACTUATOR_FULL;
+    int16_t limit = slowing && (target > 0) != (speed > 0) ? 0 : target;
+    if (speed < limit) speed = speed + change < limit ? speed + change : limit;
+    else speed = speed - change > limit ? speed - change : limit;
+    pulse();
+}
+
+/**
+ * @brief Hands the waveform of the current speed to the generator; a
+ *        stopped servo keeps its neutral pulse only with ACTUATOR_HOLD
+ */
+void Actuator::pulse() {
+    if (pin == NO_PIN) return;
+    if (speed == 0 && target == 0 && !ACTUATOR_HOLD) {
+        if (running) stopWaveform(pin);
+        running = false;
+        return;
+    }
+    uint32_t high = ACTUATOR_NEUTRAL + (long)speed * ACTUATOR_SPAN / ACTUATOR_FULL;
+    startWaveform(pin, high, ACTUATOR_FRAME - high);
+    running = true;
+}
+
+/**
+ * @brief Ramp towards a speed. The first step is taken at once and half
+ *        a step ahead: each step then holds the speed of the middle of
+ *        its interval and the staircase runs the distance of the straight
+ *        ramp that stopping() counts on
+ *
+ * @param speed -ACTUATOR_FULL (closing) to ACTUATOR_FULL (opening)
+ */
+void Actuator::drive(int16_t speed) {
+    advance(millis());
+    target = speed;
+    slew(ACTUATOR_STEP / 2);
+}
+
+/**
+ * @brief Ramp down to a standstill
+ */
+void Actuator::stop() {drive(0);}
+
+/**
+ * @brief Stop at once, at an end where coasting would grind
+ */
+void Actuator::brake() {
+    advance(millis());
+    speed = 0;
+    target = 0;
+    pulse();
+}
+
+/**
+ * @brief Ramp step, run by the scheduler every ACTUATOR_STEP while
+ *        ramping
+ */
+void Actuator::update() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - sampled;
+    advance(now);
+    slew(elapsed);
+}
+
+/**
+ * @brief Start counting the distance run from here
+ */
+void Actuator::mark() {
+    advance(millis());
+    distance = 0;
+}
+
+/**
+ * @brief Whether the speed is still on a ramp
+ *
+ * @return true until the target speed is reached
+ */
+bool Actuator::ramping() {return speed != target;}
+
+/**
+ * @brief Commanded speed
+ *
+ * @return int16_t -ACTUATOR_FULL (closing) to ACTUATOR_FULL (opening)
+ */
+int16_t Actuator::getSpeed() {return speed;}
+
+/**
+ * @brief Distance run since the last mark
+ *
+ * @return long in ms at full speed, opening being positive
+ */
+long Actuator::travelled() {
+    return (distance + (long)speed * (long)(millis() - sampled)) / ACTUATOR_FULL;
+}
+
+/**
+ * @brief Distance the servo still runs if it is stopped now, in ms at
+ *        full speed; the deceleration ramp covers half of its length
+ *
+ * @return unsigned long
+ */
+unsigned long Actuator::stopping() {
+    unsigned long magnitude = speed < 0 ? -speed : speed;
+    return magnitude * magnitude * ACTUATOR_DECELERATION / (2UL * ACTUATOR_FULL * ACTUATOR_FULL);
+}
@@ -12,167 +12,777 @@
 #include <IoT3.h>
 
 /**
- * GPIO pin definitions
+ * Photocell sampling period
  */
-#ifdef ESP12E
-#define SERVO_PIN     15
-#define PHOTOCELL_PIN A0
-#else
-#define SERVO_PIN      2
-#define PHOTOCELL_PIN A0
-#endif
+#define PHOTOCELL_PERIOD 250
 
-/**
- * Servo spin directions
- */
-#define SPIN_FORWARD    0
-#define SPIN_REVERSE  150
-#define SPIN_DELAY   2000
+extern Scheduler scheduler;
 
 /**
  * @brief Construct a new Blinds:: Blinds object
  * 
  * @param observer 
  */
-Blinds::Blinds(BlindsObserver& observer) :
-    observer(observer), mode(BM_MANUAL), state(BS_CLOSED) {}
+template <class Board, class Observer>
+BasicBlinds<Board, Observer>::BasicBlinds(Observer& observer) :
+    observer(observer), timer(-1), alarm(-1) {
+    photocell.night = 0;
+    photocell.day = 0;
+    photocell.dwell = 0;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        channels[i].state = BS_CLOSED;
+        channels[i].mode = BM_MANUAL;
+        channels[i].position = 0;
+        channels[i].target = 0;
+        channels[i].origin = 0;
+        channels[i].opening = Board::travel;
+        channels[i].closing = Board::travel;
+        channels[i].calibration = CP_NONE;
+        channels[i].released = false;
+        channels[i].wired = false;
+        channels[i].homed = false;
+        channels[i].startTime = 0;
+    }
+}
+
+/**
+ * @brief Learned time of the travel in progress, from one end to the
+ *        other
+ *
+ * @param channel
+ * @return unsigned long ms
+ */
+template <class Board, class Observer>
+unsigned long BasicBlinds<Board, Observer>::duration(uint8_t channel) {
+    const Channel& c = channels[channel];
+    return c.state == BS_OPENING ? c.opening : c.closing;
+}
+
+/**
+ * @brief Estimated position by dead reckoning: the actuator integrates
+ *        the speeds it was given, ramps included, and the position
+ *        moves by Board::travel units over the learned time of the
+ *        direction at full speed. A calibration step does not know
+ *        where it is until it is told
+ *
+ * @param channel
+ * @return unsigned long 0 when closed, Board::travel when opened
+ */
+template <class Board, class Observer>
+unsigned long BasicBlinds<Board, Observer>::where(uint8_t channel) {
+    const Channel& c = channels[channel];
+    if (c.calibration || (c.state != BS_OPENING && c.state != BS_CLOSING)) return c.position;
+    long position = c.position + actuators[channel].travelled() * (long)Board::travel / (long)duration(channel);
+    if (position < 0) position = 0;
+    if (position > (long)Board::travel) position = Board::travel;
+    if (c.state == BS_OPENING) return (unsigned long)position < c.target ? position : c.target;
+    return (unsigned long)position > c.target ? position : c.target;
+}
+
+/**
+ * @brief How far a moving channel is from its target
+ *
+ * @param channel
+ * @return unsigned long in ms at full speed
+ */
+template <class Board, class Observer>
+unsigned long BasicBlinds<Board, Observer>::left(uint8_t channel) {
+    const Channel& c = channels[channel];
+    unsigned long position = where(channel);
+    unsigned long distance = c.target > position ? c.target - position : position - c.target;
+    return (distance * duration(channel) + Board::travel - 1) / Board::travel;
+}
+
+/**
+ * @brief Reads the end-stop of a moving channel. The switch of the end
+ *        the blinds leave is still closed when they start, so a closed
+ *        switch only counts once it was seen open since the travel
+ *        started, and only on a travel to an end: a position in between
+ *        is never reached on a switch. Homing is the exception, the
+ *        blinds may already rest against the end they head for
+ *
+ * @param channel
+ * @return true if the blinds are at the end they head for
+ */
+template <class Board, class Observer>
+bool BasicBlinds<Board, Observer>::endStop(uint8_t channel) {
+    if (Board::endStopPin(channel) == NO_PIN) return false;
+    Channel& c = channels[channel];
+    if (digitalRead(Board::endStopPin(channel)) != LOW) {
+        c.released = true;
+        return false;
+    }
+    c.wired = true;
+    if (c.target != 0 && c.target != Board::travel) return false;
+    if (c.calibration == CP_HOMING && !c.released) return where(channel) < Board::travel / 2;
+    return c.released;
+}
+
+/**
+ * @brief Whether a channel past its learned time keeps going: a travel
+ *        to an end with a working end-stop runs until the switch closes,
+ *        up to 1/END_STOP_OVERRUN of the learned time late
+ *
+ * @param channel
+ * @return true while the blinds should still be moving
+ */
+template <class Board, class Observer>
+bool BasicBlinds<Board, Observer>::overrun(uint8_t channel) {
+    const Channel& c = channels[channel];
+    if (!c.wired || (c.target != 0 && c.target != Board::travel)) return false;
+    unsigned long distance = c.target > c.origin ? c.target - c.origin : c.origin - c.target;
+    unsigned long expected = (distance * duration(channel) + Board::travel - 1) / Board::travel;
+    unsigned long travelled = labs(actuators[channel].travelled());
+    return travelled < expected + duration(channel) / END_STOP_OVERRUN;
+}
+
+/**
+ * @brief Arm the travel timer for the channel that has to slow down
+ *        first, at full speed; a single timer serves every channel. A
+ *        channel with an end-stop is also looked at every
+ *        END_STOP_PERIOD on its way, and a ramp takes a step every
+ *        ACTUATOR_STEP
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::arm() {
+    scheduler.cancel(timer);
+    timer = -1;
+    unsigned long next = 0;
+    bool due = false;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        const Channel& c = channels[i];
+        unsigned long wait = ACTUATOR_STEP;
+        if (c.state == BS_OPENING || c.state == BS_CLOSING) {
+            if (c.calibration) {
+                unsigned long elapsed = millis() - c.startTime;
+                wait = elapsed < MAX_TRAVEL ? MAX_TRAVEL - elapsed : 0;
+            }
+            else {
+                unsigned long distance = left(i);
+                unsigned long stopping = actuators[i].stopping();
+                wait = distance > stopping ? distance - stopping : 0;
+            }
+            if (Board::endStopPin(i) != NO_PIN && (wait == 0 || wait > END_STOP_PERIOD)) wait = END_STOP_PERIOD;
+        }
+        else if (!actuators[i].ramping()) continue;
+        if (actuators[i].ramping() && wait > ACTUATOR_STEP) wait = ACTUATOR_STEP;
+        if (!due || wait < next) next = wait;
+        due = true;
+    }
+    if (due) timer = scheduler.after(next, tick, this);
+}
+
+/**
+ * @brief Start the servo from the position of the channel towards a
+ *        target; blinds leaving an end tell that their switch is there
+ *
+ * @param channel
+ * @param target 0 (closed) to Board::travel (opened)
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::spin(uint8_t channel, unsigned long target) {
+    Channel& c = channels[channel];
+
+    /**
+     * Blinds still coasting after a halt are short of where it left
+     * them by the rest of the ramp, which is counted again from the mark
+     */
+    int16_t speed = actuators[channel].getSpeed();
+    if (speed && c.state != BS_OPENING && c.state != BS_CLOSING) {
+        unsigned long coast = actuators[channel].stopping() * Board::travel / (speed > 0 ? c.opening : c.closing);
+        if (speed > 0) c.position = c.position > coast ? c.position - coast : 0;
+        else c.position = c.position + coast < Board::travel ? c.position + coast : Board::travel;
+    }
+
+    /**
+     * Blinds reversed within their coast of the end they head for, or
+     * already against it waiting for its switch, would have the end
+     * absorb the coast that dead reckoning counts: the servo is braked
+     * on the spot instead
+     */
+    else if (speed && (c.target == 0 || c.target == Board::travel) && (target > c.position) != (c.state == BS_OPENING)) {
+        unsigned long coast = actuators[channel].stopping() * Board::travel / duration(channel);
+        unsigned long distance = c.target > c.position ? c.target - c.position : c.position - c.target;
+        if (distance <= coast) actuators[channel].brake();
+    }
+    c.target = target;
+    BlindsState next = target > c.position ? BS_OPENING : BS_CLOSING;
+    actuators[channel].mark();
+    actuators[channel].drive(next == BS_OPENING ? ACTUATOR_FULL : -ACTUATOR_FULL);
+    c.startTime = millis();
+    c.origin = c.position;
+    c.released = false;
+    if (Board::endStopPin(channel) != NO_PIN && digitalRead(Board::endStopPin(channel)) == LOW) c.wired = true;
+    BlindsState previous = (BlindsState)c.state;
+    c.state = next;
+    arm();
+    if (next == previous) return;
+    if (next == BS_OPENING) observer.onOpening(channel);
+    else observer.onClosing(channel);
+}
+
+/**
+ * @brief Start the servo towards a position, from wherever the blinds
+ *        are; a travel in progress is reversed or extended on the spot
+ *
+ * @param channel
+ * @param target 0 (closed) to Board::travel (opened)
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::move(uint8_t channel, unsigned long target) {
+    Channel& c = channels[channel];
+    c.position = where(channel);
+    if (target == c.position) {
+        c.target = target;
+        if (c.state == BS_OPENING || c.state == BS_CLOSING) halt(channel);
+        return;
+    }
+    spin(channel, target);
+}
+
+/**
+ * @brief Ramp the servo down; the blinds rest where the ramp leaves
+ *        them, not past their target. Partly opened blinds count as
+ *        opened
+ *
+ * @param channel
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::halt(uint8_t channel) {
+    Channel& c = channels[channel];
+    unsigned long position = where(channel);
+    unsigned long coast = actuators[channel].stopping() * Board::travel / duration(channel);
+    if (c.state == BS_OPENING) position = position + coast < c.target ? position + coast : c.target;
+    else if (c.state == BS_CLOSING) position = position > c.target + coast ? position - coast : c.target;
+    c.position = position;
+    c.target = c.position;
+    c.homed = false;
+    actuators[channel].stop();
+    c.state = c.position ? BS_OPENED : BS_CLOSED;
+    arm();
+    if (c.state == BS_OPENED) observer.onOpened(channel);
+    else observer.onClosed(channel);
+}
+
+/**
+ * @brief Brake the servo at the end its switch closed at; the position
+ *        is known again. The switches of both ends share the input, the
+ *        one that tripped is at the target: the other one was seen open
+ *        since the blinds left. A travel from the other end, where a
+ *        switch stopped it too, refines the learned time of the
+ *        direction
+ *
+ * @param channel
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::reach(uint8_t channel) {
+    Channel& c = channels[channel];
+    unsigned long end = c.target;
+    actuators[channel].brake();
+    unsigned long elapsed = labs(actuators[channel].travelled());
+    bool full = c.homed && c.origin == Board::travel - end;
+    actuators[channel].mark();
+    c.position = end;
+    c.target = end;
+    halt(channel);
+    c.homed = true;
+    if (!full || elapsed < MIN_TRAVEL || elapsed > MAX_TRAVEL) return;
+
+    /**
+     * Half of the way to the time just measured at full speed; the
+     * switch is read every END_STOP_PERIOD, a single travel is not
+     * trusted alone
+     */
+    uint16_t& learned = end ? c.opening : c.closing;
+    uint16_t refined = (learned + elapsed + 1) / 2;
+    if (refined == learned) return;
+    learned = refined;
+    observer.onTravel(channel);
+}
+
+/**
+ * @brief Record a command or an event in the trace; it was ignored if
+ *        it left the channel as it was
+ *
+ * @param channel
+ * @param source
+ * @param event
+ * @param from state before the event
+ * @param target before the event
+ * @param position in %
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::trace(uint8_t channel, TraceSource source, uint8_t event, uint8_t from, uint16_t target, uint8_t position) {
+    const Channel& c = channels[channel];
+    Trace::record(channel, source, event, from, c.state, c.mode, position,
+        c.state == from && c.target == target ? TF_IGNORED : 0);
+}
 
 /**
  * @brief Set the state of the blinds according to a given event
  * 
+ * @param channel
  * @param event 
  */
-void Blinds::setState(BlindsEvent event) {
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setState(uint8_t channel, BlindsEvent event) {
+    if (channel >= CHANNELS) return;
+    const Channel& c = channels[channel];
+    uint8_t from = c.state;
+    uint16_t target = c.target;
+    TraceSource source = event == BE_END_STOP ? TS_END_STOP : event == BE_TIMEOUT ? TS_TIMEOUT : TS_MQTT;
+    if (c.calibration) {
+
+        /**
+         * Calibrating: a stop or the end-stop tells that the blinds
+         * reached the end of a step, running out of time gives up.
+         * Nothing else moves them meanwhile
+         */
+        if (event == BE_STOP || event == BE_END_STOP) step(channel);
+        else if (event == BE_TIMEOUT) abort(channel);
+        trace(channel, source, event, from, target, getPosition(channel));
+        return;
+    }
     switch (event) {
         case BE_OPEN:
-            if (mode == BM_MANUAL && state == BS_CLOSED) {
+            if (c.mode == BM_MANUAL && c.target != Board::travel) {
 
                 /** 
-                 * User is opening the blinds from the cellphone app
+                 * User is opening the blinds from the cellphone app,
+                 * possibly while they are closing
                  */
-                servo.attach(SERVO_PIN);
-                servo.write(SPIN_REVERSE);
-                startTime = millis();
-                state = BS_OPENING;
-                observer.onOpening();
+                move(channel, Board::travel);
             }
             break;
         case BE_CLOSE:
-            if (mode == BM_MANUAL && state == BS_OPENED) {
+            if (c.mode == BM_MANUAL && c.target != 0) {
 
                 /** 
-                 * User is closing the blinds from the cellphone app
+                 * User is closing the blinds from the cellphone app,
+                 * possibly while they are opening
                  */
-                servo.attach(SERVO_PIN);
-                servo.write(SPIN_FORWARD);
-                startTime = millis();
-                state = BS_CLOSING;
-                observer.onClosing();
+                move(channel, 0);
+            }
+            break;
+        case BE_STOP:
+            if (c.mode == BM_MANUAL && (c.state == BS_OPENING || c.state == BS_CLOSING)) {
+
+                /**
+                 * User is stopping the blinds mid-travel
+                 */
+                halt(channel);
             }
             break;
         case BE_TIMEOUT:
-            if (state == BS_OPENING) {
+            if (c.state == BS_OPENING || c.state == BS_CLOSING) {
 
                 /** 
-                 * Blinds are completely opened
+                 * Blinds reached their target
                  */
-                servo.detach();
-                state = BS_OPENED;
-                observer.onOpened();
-
-            } else if (state == BS_CLOSING) {
+                halt(channel);
+            }
+            break;
+        case BE_END_STOP:
+            if (c.state == BS_OPENING || c.state == BS_CLOSING) {
 
-                /** 
-                 * Blinds are completely closed
+                /**
+                 * Blinds hit an end, early or late
                  */
-                servo.detach();
-                state = BS_CLOSED;
-                observer.onClosed();
+                reach(channel);
             }
             break;
         case BE_DAYTIME:
-            if (mode == BM_AUTOMATIC && state == BS_CLOSED) {
+            source = TS_PHOTOCELL;
+            if (c.mode == BM_AUTOMATIC && c.state == BS_CLOSED) {
 
                 /**
                  * It is day time; start opening the blinds
                  */
-                servo.attach(SERVO_PIN);
-                servo.write(SPIN_REVERSE);
-                startTime = millis();
-                state = BS_OPENING;
-                observer.onOpening();
+                move(channel, Board::travel);
             }
             break;
         case BE_NIGHTTIME:
-            if (mode == BM_AUTOMATIC && state == BS_OPENED) {
+            source = TS_PHOTOCELL;
+            if (c.mode == BM_AUTOMATIC && c.state == BS_OPENED) {
 
                 /**
                  * It is night time; start opening the blinds
                  */
-                servo.attach(SERVO_PIN);
-                servo.write(SPIN_FORWARD);
-                startTime = millis();
-                state = BS_CLOSING;
-                observer.onClosing();
+                move(channel, 0);
             }
             break;
     }
+    trace(channel, source, event, from, target, getPosition(channel));
+}
+
+/**
+ * @brief Move the blinds to a given opening
+ *
+ * @param channel
+ * @param percent 0 (closed) to 100 (opened)
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setPosition(uint8_t channel, uint8_t percent) {
+    if (channel >= CHANNELS) return;
+    uint8_t from = channels[channel].state;
+    uint16_t target = channels[channel].target;
+    if (channels[channel].mode == BM_MANUAL && !channels[channel].calibration && percent <= 100) move(channel, (unsigned long)percent * Board::travel / 100);
+    trace(channel, TS_MQTT, TE_SET_POSITION, from, target, percent);
 }
 
 /**
  * @brief Set the mode of operation of the blinds
  * 
+ * @param channel
  * @param mode BM_AUTOMATIC
  *             BM_MANUAL
  */
-void Blinds::setMode(BlindsMode mode) {
-    this->mode = mode;
-    observer.onSetMode();
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setMode(uint8_t channel, BlindsMode mode) {
+    if (channel >= CHANNELS) return;
+    channels[channel].mode = mode;
+    Trace::record(channel, TS_MQTT, TE_SET_MODE, channels[channel].state, channels[channel].state, mode, getPosition(channel), 0);
+    observer.onSetMode(channel);
+    if (mode == BM_AUTOMATIC) follow();
+}
+
+/**
+ * @brief Restore the mode, the state and the position saved before a
+ *        reset; a travel cut by the reset counts as not started
+ * 
+ * @param channel
+ * @param mode 
+ * @param state 
+ * @param percent 
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::restore(uint8_t channel, BlindsMode mode, BlindsState state, uint8_t percent) {
+    if (channel >= CHANNELS) return;
+    Channel& c = channels[channel];
+    if (mode == BM_MANUAL || mode == BM_AUTOMATIC) c.mode = mode;
+    c.state = (state == BS_OPENED || state == BS_CLOSING) ? BS_OPENED : BS_CLOSED;
+    if (percent > 100) percent = 100;
+    c.position = c.state == BS_CLOSED ? 0 : percent ? (unsigned long)percent * Board::travel / 100 : Board::travel;
+    c.target = c.position;
+    c.homed = c.wired && (c.position == 0 || c.position == Board::travel);
+}
+
+/**
+ * @brief Start learning the travel times of a channel: the blinds close
+ *        until told they are closed, then open and close again while
+ *        each travel is timed. They are told by a stop, or by the
+ *        end-stop when there is one
+ *
+ * @param channel
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::calibrate(uint8_t channel) {
+    if (channel >= CHANNELS) return;
+    Channel& c = channels[channel];
+    uint8_t from = c.state;
+    bool started = c.mode == BM_MANUAL && !c.calibration;
+    if (started) {
+        c.position = where(channel);
+        c.calibration = CP_HOMING;
+        spin(channel, 0);
+    }
+    Trace::record(channel, TS_MQTT, TE_CALIBRATE, from, c.state, c.mode, getPosition(channel), started ? 0 : TF_IGNORED);
+}
+
+/**
+ * @brief The blinds reached the end of a calibration step; the servo
+ *        is braked and the next step starts from there. The times
+ *        measured, at full speed, replace the learned ones when they
+ *        are plausible
+ *
+ * @param channel
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::step(uint8_t channel) {
+    Channel& c = channels[channel];
+    actuators[channel].brake();
+    unsigned long elapsed = labs(actuators[channel].travelled());
+    bool plausible = elapsed >= MIN_TRAVEL && elapsed <= MAX_TRAVEL;
+    switch (c.calibration) {
+        case CP_HOMING:
+            c.calibration = CP_OPENING;
+            c.position = 0;
+            spin(channel, Board::travel);
+            break;
+        case CP_OPENING:
+            if (plausible) c.opening = elapsed;
+            c.calibration = CP_CLOSING;
+            c.position = Board::travel;
+            spin(channel, 0);
+            break;
+        case CP_CLOSING:
+            if (plausible) c.closing = elapsed;
+            c.calibration = CP_NONE;
+            c.position = 0;
+            actuators[channel].mark();
+            halt(channel);
+            c.homed = c.wired;
+            observer.onTravel(channel);
+            break;
+    }
+}
+
+/**
+ * @brief A calibration step ran for MAX_TRAVEL without reaching an end;
+ *        the blinds are left at the end they were heading for, with
+ *        the times learned so far
+ *
+ * @param channel
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::abort(uint8_t channel) {
+    Channel& c = channels[channel];
+    c.calibration = CP_NONE;
+    c.position = c.state == BS_OPENING ? Board::travel : 0;
+    actuators[channel].brake();
+    actuators[channel].mark();
+    halt(channel);
+    observer.onTravel(channel);
+}
+
+/**
+ * @brief Whether a channel is being calibrated
+ *
+ * @param channel
+ * @return true until the last step is over
+ */
+template <class Board, class Observer>
+bool BasicBlinds<Board, Observer>::isCalibrating(uint8_t channel) {return channels[channel].calibration != CP_NONE;}
+
+/**
+ * @brief Restore the travel times learned before a reset; implausible
+ *        ones keep the travel of the board
+ *
+ * @param channel
+ * @param opening in ms
+ * @param closing in ms
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setTravel(uint8_t channel, uint16_t opening, uint16_t closing) {
+    if (channel >= CHANNELS) return;
+    Channel& c = channels[channel];
+    c.opening = opening >= MIN_TRAVEL && opening <= MAX_TRAVEL ? opening : Board::travel;
+    c.closing = closing >= MIN_TRAVEL && closing <= MAX_TRAVEL ? closing : Board::travel;
+}
+
+/**
+ * @brief Learned travel time of a channel
+ *
+ * @param channel
+ * @param direction BS_OPENING or BS_CLOSING
+ * @return uint16_t ms from one end to the other
+ */
+template <class Board, class Observer>
+uint16_t BasicBlinds<Board, Observer>::getTravel(uint8_t channel, BlindsState direction) {
+    return direction == BS_OPENING ? channels[channel].opening : channels[channel].closing;
 }
 
 /**
  * @brief Start opening the blinds 
+ *
+ * @param channel
  */
-void Blinds::open(){setState(BE_OPEN);}
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::open(uint8_t channel){setState(channel, BE_OPEN);}
 
 /**
  * @brief Start closing the blinds
+ *
+ * @param channel
  */
-void Blinds::close(){setState(BE_CLOSE);}
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::close(uint8_t channel){setState(channel, BE_CLOSE);}
 
 /**
  * @brief Get the mode of operation of the blinds
  * 
+ * @param channel
  * @return BM_AUTOMATIC
  *         BM_MANUAL 
  */
-BlindsMode Blinds::getMode() {return mode;}
+template <class Board, class Observer>
+BlindsMode BasicBlinds<Board, Observer>::getMode(uint8_t channel) {return (BlindsMode)channels[channel].mode;}
 
 /**
  * @brief Determines the state of the blinds 
  * 
+ * @param channel
  * @return  BS_OPENING
  *          BS_OPENED
  *          BS_CLOSING
  *          BS_CLOSED
  */
-BlindsState Blinds::getState(){return state;}
+template <class Board, class Observer>
+BlindsState BasicBlinds<Board, Observer>::getState(uint8_t channel){return (BlindsState)channels[channel].state;}
+
+/**
+ * @brief Estimated opening of the blinds
+ *
+ * @param channel
+ * @return uint8_t 0 (closed) to 100 (opened)
+ */
+template <class Board, class Observer>
+uint8_t BasicBlinds<Board, Observer>::getPosition(uint8_t channel) {return (where(channel) * 100 + Board::travel / 2) / Board::travel;}
 
 /**
- * @brief Determines whether or not it is the night by performing 
- *        an analog reading of the photocell pin
+ * @brief Determines whether or not it is the night by sampling the
+ *        photocell of the channel through its filter
  * 
+ * @param channel
  * @return true 
  * @return false 
  */
-bool Blinds::isNightTime(){
-    return analogRead(PHOTOCELL_PIN) < 150;
+template <class Board, class Observer>
+bool BasicBlinds<Board, Observer>::isNightTime(uint8_t channel){
+    return photocells[channel].update(Board::photocellPin(channel),
+        photocell.night ? photocell.night : Board::nightThreshold,
+        photocell.day ? photocell.day : Board::dayThreshold,
+        photocell.dwell ? photocell.dwell : Board::dwell);
+}
+
+/**
+ * @brief Whether the schedule drives a channel rather than its
+ *        photocell; it does once the clock is set, for the channels its
+ *        rules name
+ *
+ * @param channel
+ * @return true if the channel follows the schedule
+ */
+template <class Board, class Observer>
+bool BasicBlinds<Board, Observer>::scheduled(uint8_t channel) {
+    return schedule.drives(channel) && Schedule::valid(time(nullptr));
+}
+
+/**
+ * @brief Move the channels in automatic mode to where the last rule of
+ *        the schedule put them
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::follow() {
+    time_t now = time(nullptr);
+    if (!Schedule::valid(now)) return;
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        const Channel& c = channels[i];
+        if (c.mode != BM_AUTOMATIC || c.calibration || !schedule.drives(i)) continue;
+        int percent = schedule.position(i, now);
+        if (percent < 0) continue;
+        unsigned long target = (unsigned long)percent * Board::travel / 100;
+        if (target == c.target) continue;
+        uint8_t from = c.state;
+        uint16_t previous = c.target;
+        move(i, target);
+        trace(i, TS_SCHEDULE, TE_SCHEDULE, from, previous, percent);
+    }
+}
+
+/**
+ * @brief Arm the schedule timer for the next rule boundary; the channels
+ *        do not change between two of them. An unset clock is looked at
+ *        again every SCHEDULE_RETRY
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::plan() {
+    scheduler.cancel(alarm);
+    alarm = -1;
+    if (schedule.empty()) return;
+    time_t now = time(nullptr);
+    unsigned long wait = SCHEDULE_RETRY;
+    if (Schedule::valid(now)) {
+        time_t next = schedule.next(now);
+        wait = SCHEDULE_HORIZON;
+        if (next && next - now < SCHEDULE_HORIZON / 1000) wait = (next - now) * 1000UL;
+    }
+    alarm = scheduler.after(wait, wake, this);
+}
+
+/**
+ * @brief Replace the schedule; the channels it drives go at once where
+ *        its last rule put them
+ *
+ * @param settings
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setSchedule(const ScheduleSettings& settings) {
+    schedule.set(settings);
+    follow();
+    plan();
+}
+
+/**
+ * @brief Change the thresholds of the photocells; a field at 0 keeps
+ *        the default of the board
+ *
+ * @param settings
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setPhotocell(const PhotocellSettings& settings) {photocell = settings;}
+
+/**
+ * @brief Filtered light on the photocell of a channel
+ *
+ * @param channel
+ * @return uint16_t 0 to MAX_LIGHT
+ */
+template <class Board, class Observer>
+uint16_t BasicBlinds<Board, Observer>::getLight(uint8_t channel) {return photocells[channel].getLevel();}
+
+/**
+ * @brief Scheduler task sampling the photocells
+ *
+ * @param context the blinds
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::sample(void* context) {
+    ((BasicBlinds*)context)->loop();
+}
+
+/**
+ * @brief Scheduler timer fired when the first travel has to slow down,
+ *        a ramp takes a step or an end-stop is due to be read; every
+ *        channel that arrived is stopped in the same pass
+ *
+ * @param context the blinds
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::tick(void* context) {
+    BasicBlinds* blinds = (BasicBlinds*)context;
+    blinds->timer = -1;
+    for (uint8_t i = 0; i < CHANNELS; i++) blinds->actuators[i].update();
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        const Channel& c = blinds->channels[i];
+        if (c.state != BS_OPENING && c.state != BS_CLOSING) continue;
+        if (blinds->endStop(i)) blinds->setState(i, BE_END_STOP);
+        else if (c.calibration ? millis() - c.startTime >= MAX_TRAVEL :
+            blinds->left(i) <= blinds->actuators[i].stopping() && !blinds->overrun(i)) {
+            blinds->setState(i, BE_TIMEOUT);
+        }
+    }
+    blinds->arm();
+}
+
+/**
+ * @brief Scheduler timer fired at a rule boundary of the schedule
+ *
+ * @param context the blinds
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::wake(void* context) {
+    BasicBlinds* blinds = (BasicBlinds*)context;
+    blinds->alarm = -1;
+    blinds->follow();
+    blinds->plan();
 }
 
 /**
  * @brief Initialise the firmware
  */
-void Blinds::setup() {
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::setup() {
 
     /**
      * Initialize serial communication baud rate
@@ -182,32 +792,51 @@ void Blinds::setup() {
     /**
      * Initialize GPIO pins
      */
-    pinMode(SERVO_PIN, OUTPUT);
-    pinMode(PHOTOCELL_PIN, INPUT);
-}
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        pinMode(Board::servoPin(i), OUTPUT);
+        actuators[i].attach(Board::servoPin(i));
+        pinMode(Board::photocellPin(i), INPUT);
+        if (Board::endStopPin(i) == NO_PIN) continue;
 
-/**
- * @brief Main loop
- */
-void Blinds::loop() {
+        /**
+         * Blinds resting at an end tell that their switch is there
+         */
+        pinMode(Board::endStopPin(i), INPUT_PULLUP);
+        if (digitalRead(Board::endStopPin(i)) == LOW) channels[i].wired = true;
+    }
 
     /**
-     * Update the state of the blinds according to time
+     * The travel timer is armed by each move; only the photocells
+     * need polling
      */
-    if (millis() - startTime > SPIN_DELAY) setState(BE_TIMEOUT);
+    scheduler.poll(PHOTOCELL_PERIOD, sample, this);
+}
 
-    /**
-     * Update the state of the blinds according to the light
-     */
-    if (isNightTime()) {
-        setState(BE_NIGHTTIME);
-    }
-    else {
-        setState(BE_DAYTIME);
-    }
+/**
+ * @brief Main loop, run by the scheduler every PHOTOCELL_PERIOD
+ */
+template <class Board, class Observer>
+void BasicBlinds<Board, Observer>::loop() {
+    METRIC_TIME(MT_BLINDS);
 
     /**
-     * Required for MQTT
+     * Update the state of each channel according to the light; the
+     * photocell of a channel the schedule drives is only kept sampled,
+     * to take over should the clock be lost
      */
-    delay(50);
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        bool night = isNightTime(i);
+        if (scheduled(i)) continue;
+        if (night) {
+            setState(i, BE_NIGHTTIME);
+        }
+        else {
+            setState(i, BE_DAYTIME);
+        }
+    }
 }
+
+/**
+ * The blinds of the board this firmware is built for
+ */
+template class BasicBlinds<Board, BlindsStub>;
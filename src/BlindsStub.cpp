@@ -20,6 +20,9 @@
  */
 #define TOPIC_COMMANDS "/IOT3/COMMANDS"
 #define TOPIC_STATES   "/IOT3/STATES"
+#define TOPIC_DIAGNOSTICS "/IOT3/DIAGNOSTICS"
+#define TOPIC_TRACE    "/IOT3/TRACE"
+#define TOPIC_GROUPS   "/IOT3/GROUPS"
 
 /**
  * Commands
@@ -28,6 +31,40 @@
 #define CMD_CLOSE         "close"
 #define CMD_SET_MODE      "set_mode"
 #define CMD_QUERY_OBJECTS "query_objects"
+#define CMD_STOP          "stop"
+#define CMD_SET_POSITION  "set_position"
+#define CMD_SET_FORMAT    "set_format"
+#define CMD_DUMP_TRACE    "dump_trace"
+#define CMD_SET_PHOTOCELL "set_photocell"
+#define CMD_CALIBRATE     "calibrate"
+#define CMD_SET_SCHEDULE  "set_schedule"
+#define CMD_SET_RULE      "set_rule"
+#define CMD_JOIN          "join"
+#define CMD_LEAVE         "leave"
+
+/**
+ * Command lookup table
+ */
+static const struct {
+    const char* name;
+    uint8_t length;
+    BlindsCommand command;
+} commands[] = {
+    {CMD_OPEN, sizeof(CMD_OPEN) - 1, BC_OPEN},
+    {CMD_CLOSE, sizeof(CMD_CLOSE) - 1, BC_CLOSE},
+    {CMD_SET_MODE, sizeof(CMD_SET_MODE) - 1, BC_SET_MODE},
+    {CMD_QUERY_OBJECTS, sizeof(CMD_QUERY_OBJECTS) - 1, BC_QUERY_OBJECTS},
+    {CMD_STOP, sizeof(CMD_STOP) - 1, BC_STOP},
+    {CMD_SET_POSITION, sizeof(CMD_SET_POSITION) - 1, BC_SET_POSITION},
+    {CMD_SET_FORMAT, sizeof(CMD_SET_FORMAT) - 1, BC_SET_FORMAT},
+    {CMD_DUMP_TRACE, sizeof(CMD_DUMP_TRACE) - 1, BC_DUMP_TRACE},
+    {CMD_SET_PHOTOCELL, sizeof(CMD_SET_PHOTOCELL) - 1, BC_SET_PHOTOCELL},
+    {CMD_CALIBRATE, sizeof(CMD_CALIBRATE) - 1, BC_CALIBRATE},
+    {CMD_SET_SCHEDULE, sizeof(CMD_SET_SCHEDULE) - 1, BC_SET_SCHEDULE},
+    {CMD_SET_RULE, sizeof(CMD_SET_RULE) - 1, BC_SET_RULE},
+    {CMD_JOIN, sizeof(CMD_JOIN) - 1, BC_JOIN},
+    {CMD_LEAVE, sizeof(CMD_LEAVE) - 1, BC_LEAVE},
+};
 
 /**
  * Debug message 
@@ -48,21 +85,109 @@
 #define MODE_MANUAL    "manual"
 #define MODE_AUTOMATIC "automatic"
 
+/**
+ * Events of the schedule rules
+ */
+#define EVENT_TIME    "time"
+#define EVENT_SUNRISE "sunrise"
+#define EVENT_SUNSET  "sunset"
+
+/**
+ * Wire formats; a device speaking both tells so in its state message
+ */
+#define FORMAT_JSON    "json"
+#define FORMAT_MSGPACK "msgpack"
+
 /**
  * Limits
  */
-#define MAX_PAYLOAD 256
 #define MAX_MAC     6
 
+/**
+ * The state message holds 'ip', 'name', 'format' and one object per
+ * channel; the address is the only string copied into the document
+ */
+#define STATE_SIZE (JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(CHANNELS) + CHANNELS * JSON_OBJECT_SIZE(3) + MAX_IP)
+
+/**
+ * Commands carry at most 'cmd', 'mode', 'position', 'window', 'format',
+ * 'night', 'day', 'dwell', 'latitude', 'longitude', 'offset', 'rule',
+ * 'days', 'event', 'minute' and 'group'; everything else is filtered
+ * out while parsing
+ */
+#define COMMAND_SIZE JSON_OBJECT_SIZE(16)
+#define FILTER_SIZE  JSON_OBJECT_SIZE(16)
+
+/**
+ * Window in ms over which the devices spread their replies to a
+ * query_objects on the home topic; a query may carry its own 'window'
+ */
+#ifndef QUERY_WINDOW
+#define QUERY_WINDOW 2000
+#endif
+#define MAX_QUERY_WINDOW 30000
+
+/**
+ * Period of the MQTT client polling; bounds the command latency unless
+ * the power mode stretches it
+ */
+#define MQTT_PERIOD 10
+
+/**
+ * Messages read per poll at most; a burst is read at once so that the
+ * queue can collapse it before the blinds see it
+ */
+#define MQTT_BURST MAX_COMMANDS
+
+/**
+ * Period of the diagnostics in ms
+ */
+#define METRICS_PERIOD 60000
+
+/**
+ * The MQTT client drops a packet that does not fit its buffer, 256
+ * bytes by default; the largest one is the diagnostics message or the
+ * trace
+ */
+#define MAX_OF(a, b) ((a) > (b) ? (a) : (b))
+#if METRICS
+#define MAX_PAYLOAD MAX_OF(MAX_DIAGNOSTICS, MAX_TRACE)
+#else
+#define MAX_PAYLOAD MAX_OF(MAX_MESSAGE, MAX_TRACE)
+#endif
+#define MQTT_BUFFER (MQTT_MAX_HEADER_SIZE + 2 + MAX_TOPIC + MAX_PAYLOAD)
+
 /**
  * Program variables 
  */
-WiFiClient wifiClient;
-PubSubClient client(wifiClient);
+DEVICE_STATE WiFiClient wifiClient;
+DEVICE_STATE PubSubClient client(wifiClient);
+DEVICE_STATE Connection connection(wifiClient, client);
+DEVICE_STATE Topic homeCommands;
+DEVICE_STATE Topic objectCommands;
+DEVICE_STATE Topic channelCommands;
+DEVICE_STATE Topic groupCommands[MAX_GROUPS];
+DEVICE_STATE StaticJsonDocument<FILTER_SIZE> filter;
+DEVICE_STATE CommandQueue commandQueue;
+DEVICE_STATE Publisher publisher(client);
+DEVICE_STATE Topic stateTopic;
+DEVICE_STATE Topic traceTopic;
+#if METRICS
+DEVICE_STATE Topic diagnosticsTopic;
+static DEVICE_STATE int diagnosticsTimer = -1;
+#endif
+static DEVICE_STATE unsigned long received = 0;
+static DEVICE_STATE int replyTimer = -1;
+static DEVICE_STATE PhotocellSettings photocell;
+static DEVICE_STATE ScheduleSettings schedule;
+static DEVICE_STATE GroupSettings groups;
 extern Blinds blinds;
+extern Scheduler scheduler;
 
 /**
- * @brief MQTT callback function implementation
+ * @brief MQTT callback function implementation; commands are only
+ *        queued here, the blinds apply them once the MQTT client
+ *        returns
  * 
  * @param topic 
  * @param payload 
@@ -70,73 +195,648 @@ extern Blinds blinds;
  */
 void BlindsStub::callback(char* topic, byte* payload, unsigned int length) 
 {
-    StaticJsonDocument<MAX_PAYLOAD> doc;
-    deserializeJson(doc, payload, length);
-    String cmd = doc["cmd"];
-    if (String(topic) == objectTopic(TOPIC_COMMANDS)) {
-        if (cmd == CMD_OPEN) {
-            blinds.open();
-        } else if (cmd == CMD_CLOSE) {
-            blinds.close();
-        } else if (cmd == CMD_SET_MODE) {
-            blinds.setMode(doc["mode"]);
-        }
-    } else if (String(topic) == homeTopic(TOPIC_COMMANDS)) {
-        if (cmd == CMD_QUERY_OBJECTS) {
-            publish();
-        }
+    METRIC_TIME(MT_CALLBACK);
+    received++;
+    size_t topicLength = strlen(topic);
+
+    /**
+     * A command on the object topic is for every channel, one on a
+     * numbered subtopic for that channel only, one on the topic of a
+     * group for the channels in the group
+     */
+    uint8_t channels = CHANNEL_MASK;
+    bool grouped = false;
+    bool object = objectCommands.matches(topic, topicLength);
+    if (!object) {
+        int child = objectCommands.child(topic, topicLength);
+        if (child >= CHANNELS) return;
+        object = child >= 0;
+        if (object) channels = 1 << child;
     }
-}
+    for (uint8_t i = 0; i < MAX_GROUPS && !object; i++) {
+        if (!groups.groups[i].channels || !groupCommands[i].matches(topic, topicLength)) continue;
+        object = grouped = true;
+        channels = groups.groups[i].channels;
+    }
+    if (!object && !homeCommands.matches(topic, topicLength)) return;
 
-String BlindsStub::clientName() {
-    String name = WiFi.localIP().toString();
-    return name;
-}
+    /**
+     * The payload is parsed in place; only the filtered keys are kept.
+     * Commands are JSON objects or MessagePack maps, whatever format the
+     * states are published in
+     */
+    StaticJsonDocument<COMMAND_SIZE> doc;
+    DeserializationError error = binary(payload, length) ?
+        deserializeMsgPack(doc, payload, length, DeserializationOption::Filter(filter)) :
+        deserializeJson(doc, payload, length, DeserializationOption::Filter(filter));
+    if (error) return;
+    BlindsCommand command = lookup(doc["cmd"]);
+    if (grouped && !collective(command)) return;
+    if (object) {
+        switch (command) {
+            case BC_OPEN:
+            case BC_CLOSE:
+            case BC_STOP:
+            case BC_CALIBRATE:
+                dispatch(command, 0, channels);
+                break;
+            case BC_SET_MODE: {
+                int mode = doc["mode"];
+                if (mode == BM_MANUAL || mode == BM_AUTOMATIC) dispatch(command, mode, channels);
+                break;
+            }
+            case BC_SET_POSITION: {
+                int position = doc["position"] | -1;
+                if (position >= 0 && position <= 100) dispatch(command, position, channels);
+                break;
+            }
+            case BC_SET_FORMAT: {
+                const char* format = doc["format"] | "";
+                if (!strcmp(format, FORMAT_JSON)) commandQueue.push(command, WF_JSON, ALL_CHANNELS);
+                else if (!strcmp(format, FORMAT_MSGPACK)) commandQueue.push(command, WF_MSGPACK, ALL_CHANNELS);
+                break;
+            }
+            case BC_DUMP_TRACE:
+                commandQueue.push(command, 0, ALL_CHANNELS);
+                break;
+            case BC_SET_PHOTOCELL: {
+
+                /**
+                 * The queue only carries one argument; the fields given
+                 * are merged with those of a pending set_photocell, and
+                 * taken back if the command is dropped
+                 */
+                int night = doc["night"] | 0;
+                int day = doc["day"] | 0;
+                int dwell = doc["dwell"] | 0;
+                if (night < 0 || night > MAX_LIGHT || day < 0 || day > MAX_LIGHT || dwell < 0 || dwell > MAX_DWELL) break;
+                PhotocellSettings previous = photocell;
+                if (night) photocell.night = night;
+                if (day) photocell.day = day;
+                if (dwell) photocell.dwell = dwell;
+                if (!commandQueue.push(command, 0, ALL_CHANNELS)) photocell = previous;
+                break;
+            }
+            case BC_SET_SCHEDULE: {
+
+                /**
+                 * Degrees are kept in 1/100; the fields not given keep
+                 * their value, and all of them are taken back if the
+                 * command is dropped
+                 */
+                JsonVariant latitude = doc["latitude"];
+                JsonVariant longitude = doc["longitude"];
+                JsonVariant offset = doc["offset"];
+                if (!latitude.isNull() && fabs(latitude.as<float>()) > 90) break;
+                if (!longitude.isNull() && fabs(longitude.as<float>()) > 180) break;
+                if (!offset.isNull() && abs(offset.as<int>()) > MAX_OFFSET) break;
+                ScheduleSettings previous = schedule;
+                if (!latitude.isNull()) schedule.latitude = lround(latitude.as<float>() * 100);
+                if (!longitude.isNull()) schedule.longitude = lround(longitude.as<float>() * 100);
+                if (!offset.isNull()) schedule.offset = offset.as<int>();
+                if (!commandQueue.push(command, 0, ALL_CHANNELS)) schedule = previous;
+                break;
+            }
+            case BC_SET_RULE: {
 
-String BlindsStub::homeTopic(const String& topic) {
-    String string = topic;
-    return string;
+                /**
+                 * A rule sent on a channel topic moves that channel
+                 * only; no days clear the rule. The slot is taken back
+                 * if the command is dropped
+                 */
+                int rule = doc["rule"] | -1;
+                int days = doc["days"] | -1;
+                const char* name = doc["event"] | EVENT_TIME;
+                int minute = doc["minute"] | 0;
+                int position = doc["position"] | -1;
+                uint8_t event = !strcmp(name, EVENT_TIME) ? SE_TIME : !strcmp(name, EVENT_SUNRISE) ? SE_SUNRISE :
+                    !strcmp(name, EVENT_SUNSET) ? SE_SUNSET : 0;
+                if (rule < 0 || rule >= MAX_RULES || days < 0 || days > 0x7f || !event) break;
+                if (days && (position < 0 || position > 100)) break;
+                if (event == SE_TIME ? minute < 0 || minute >= 24 * 60 : abs(minute) > MAX_OFFSET) break;
+                ScheduleRule& slot = schedule.rules[rule];
+                ScheduleRule previous = slot;
+                slot.days = days;
+                slot.event = event;
+                slot.minute = minute;
+                slot.position = days ? position : 0;
+                slot.channels = channels;
+                if (!commandQueue.push(command, 0, ALL_CHANNELS)) slot = previous;
+                break;
+            }
+            case BC_JOIN:
+            case BC_LEAVE: {
+
+                /**
+                 * The channels of the topic join or leave the group; the
+                 * group is forgotten once every channel left it. The slot,
+                 * which may have just been taken, is put back if the
+                 * command is dropped
+                 */
+                GroupSettings previous = groups;
+                int slot = find(doc["group"] | "", command == BC_JOIN);
+                if (slot < 0) break;
+                Group& group = groups.groups[slot];
+                if (command == BC_JOIN) group.channels |= channels;
+                else group.channels &= ~channels;
+                if (!group.channels) memset(&group, 0, sizeof(group));
+                if (!commandQueue.push(command, 0, ALL_CHANNELS)) group = previous.groups[slot];
+                break;
+            }
+            default:
+                break;
+        }
+    } else if (command == BC_QUERY_OBJECTS) {
+        int window = doc["window"] | QUERY_WINDOW;
+        if (window >= 0 && window <= MAX_QUERY_WINDOW) commandQueue.push(command, window, ALL_CHANNELS);
+    }
 }
 
-String BlindsStub::objectTopic(const String& topic) {
-    String string = topic;
-    string += "/";
-    string += WiFi.localIP().toString();
-    return string;
+/**
+ * @brief Apply the pending commands, oldest first
+ */
+void BlindsStub::drain() {
+    PendingCommand pending;
+    while (commandQueue.pop(pending)) {
+        switch (pending.command) {
+            case BC_QUERY_OBJECTS:
+                query(pending.argument);
+                break;
+            case BC_SET_FORMAT:
+                setFormat((WireFormat)pending.argument);
+                break;
+            case BC_DUMP_TRACE:
+                dumpTrace();
+                break;
+            case BC_SET_PHOTOCELL:
+                setPhotocell();
+                break;
+            case BC_SET_SCHEDULE:
+            case BC_SET_RULE:
+                setSchedule();
+                break;
+            case BC_JOIN:
+            case BC_LEAVE:
+                setGroups();
+                break;
+            default:
+                if (pending.channel != ALL_CHANNELS) apply(pending.channel, pending);
+                else for (uint8_t i = 0; i < CHANNELS; i++) apply(i, pending);
+                break;
+        }
+    }
 }
 
-void BlindsStub::publish() {
-    Repository repos; 
-    repos.load();
-    StaticJsonDocument<MAX_PAYLOAD> doc;
-    doc["ip"] = WiFi.localIP();
-    doc["name"] = repos.getName();
-    JsonObject object = doc.createNestedObject("objects");
-    switch (blinds.getState()){
-        case BS_OPENING:
-            object["state"] = STATE_OPENING;
+/**
+ * @brief Apply a command to the blinds of one channel
+ * 
+ * @param channel 
+ * @param pending 
+ */
+void BlindsStub::apply(uint8_t channel, const PendingCommand& pending) {
+    switch (pending.command) {
+        case BC_OPEN:
+            blinds.open(channel);
             break;
-        case BS_OPENED:
-            object["state"] = STATE_OPENED;
+        case BC_CLOSE:
+            blinds.close(channel);
             break;
-        case BS_CLOSING:
-            object["state"] = STATE_CLOSING;
+        case BC_STOP:
+            blinds.setState(channel, BE_STOP);
             break;
-        case BS_CLOSED:
-            object["state"] = STATE_CLOSED;
+        case BC_SET_MODE:
+            blinds.setMode(channel, (BlindsMode)pending.argument);
             break;
-    }
-    switch (blinds.getMode()) {
-        case BM_MANUAL:
-            object["mode"] = MODE_MANUAL;
+        case BC_SET_POSITION:
+            blinds.setPosition(channel, pending.argument);
+            break;
+        case BC_CALIBRATE:
+            blinds.calibrate(channel);
             break;
-        case BM_AUTOMATIC:
-            object["mode"] = MODE_AUTOMATIC;
+        default:
             break;
     }
-    String json;
-    serializeJsonPretty(doc, json);
-    client.publish(homeTopic(TOPIC_STATES).c_str(), json.c_str());
+}
+
+/**
+ * @brief Tells a MessagePack map from a JSON text; a JSON object can
+ *        only start with '{' or white space
+ *
+ * @param payload
+ * @param length
+ * @return true if the payload is MessagePack
+ */
+bool BlindsStub::binary(const byte* payload, unsigned int length) {
+    return length && ((payload[0] & 0xf0) == 0x80 || payload[0] == 0xde || payload[0] == 0xdf);
+}
+
+/**
+ * @brief Switch the format of the states, commands are accepted in
+ *        both; the choice survives a reset so that the retained state
+ *        keeps the format the controller asked for
+ *
+ * @param format
+ */
+void BlindsStub::setFormat(WireFormat format) {
+    if (format == Repository::cached().getFormat()) return;
+    Repository repos = Repository::cached();
+    repos.setFormat(format);
+    repos.save();
+    publish();
+}
+
+/**
+ * @brief Apply the photocell thresholds received since the last time;
+ *        they survive a reset. A day threshold below the night one
+ *        would leave no hysteresis, the change is dropped
+ */
+void BlindsStub::setPhotocell() {
+    Repository repos = Repository::cached();
+    PhotocellSettings settings = repos.getPhotocell();
+    if (photocell.night) settings.night = photocell.night;
+    if (photocell.day) settings.day = photocell.day;
+    if (photocell.dwell) settings.dwell = photocell.dwell;
+    memset(&photocell, 0, sizeof(photocell));
+    unsigned night = settings.night ? settings.night : Board::nightThreshold;
+    unsigned day = settings.day ? settings.day : Board::dayThreshold;
+    if (day < night) return;
+    repos.setPhotocell(settings);
+    repos.save();
+    blinds.setPhotocell(settings);
+}
+
+/**
+ * @brief Apply the location and the rules received since the last
+ *        time; they survive a reset
+ */
+void BlindsStub::setSchedule() {
+    Repository::saveSchedule(schedule);
+    blinds.setSchedule(schedule);
+}
+
+/**
+ * @brief Apply the groups joined or left since the last time; they
+ *        survive a reset
+ */
+void BlindsStub::setGroups() {
+    Repository::saveGroups(groups);
+    listen();
+}
+
+/**
+ * @brief Slot of a group by name
+ *
+ * @param name at most MAX_GROUP - 1 characters, none of them a
+ *        separator or a wildcard of MQTT
+ * @param create take a free slot if the group is not there
+ * @return int -1 if the name is not valid or no slot is left
+ */
+int BlindsStub::find(const char* name, bool create) {
+    size_t length = strlen(name);
+    if (!length || length >= MAX_GROUP || strpbrk(name, "/+#")) return -1;
+    int unused = -1;
+    for (uint8_t i = 0; i < MAX_GROUPS; i++) {
+        if (!strcmp(groups.groups[i].name, name)) return i;
+        if (unused < 0 && !groups.groups[i].name[0]) unused = i;
+    }
+    if (!create || unused < 0) return -1;
+    memcpy(groups.groups[unused].name, name, length + 1);
+    groups.groups[unused].channels = 0;
+    return unused;
+}
+
+/**
+ * @brief Follow the topics of the groups; only the groups that changed
+ *        are subscribed or unsubscribed. Before the first session the
+ *        topics are only set, subscribe() takes them all
+ */
+void BlindsStub::listen() {
+    bool session = client.connected();
+    for (uint8_t i = 0; i < MAX_GROUPS; i++) {
+        Topic topic;
+        if (groups.groups[i].name[0]) topic.set(TOPIC_GROUPS, groups.groups[i].name);
+        if (!strcmp(topic.c_str(), groupCommands[i].c_str())) continue;
+        if (session && *groupCommands[i].c_str()) client.unsubscribe(groupCommands[i].c_str());
+        groupCommands[i] = topic;
+        if (session && *topic.c_str()) client.subscribe(topic.c_str());
+    }
+}
+
+/**
+ * @brief Whether a command can be sent to a group: those that move the
+ *        blinds or change their mode
+ *
+ * @param command
+ * @return true if the command is taken on a group topic
+ */
+bool BlindsStub::collective(BlindsCommand command) {
+    switch (command) {
+        case BC_OPEN:
+        case BC_CLOSE:
+        case BC_STOP:
+        case BC_SET_POSITION:
+        case BC_CALIBRATE:
+        case BC_SET_MODE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Queue a command for some channels; one for every channel goes
+ *        as a single entry
+ *
+ * @param command
+ * @param argument
+ * @param channels mask
+ */
+void BlindsStub::dispatch(BlindsCommand command, int16_t argument, uint8_t channels) {
+    if (channels == CHANNEL_MASK) {
+        commandQueue.push(command, argument, ALL_CHANNELS);
+        return;
+    }
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (channels & (1 << i)) commandQueue.push(command, argument, i);
+    }
+}
+
+/**
+ * @brief Translate a command name
+ * 
+ * @param cmd may be null
+ * @return BC_NONE if unknown
+ */
+BlindsCommand BlindsStub::lookup(const char* cmd) {
+    if (cmd == nullptr) return BC_NONE;
+    size_t length = strlen(cmd);
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (length == commands[i].length && memcmp(cmd, commands[i].name, length) == 0) {
+            return commands[i].command;
+        }
+    }
+    return BC_NONE;
+}
+
+/**
+ * @brief Scheduler task polling the MQTT client, then applying what
+ *        was received outside of the MQTT stack
+ *
+ * @param context unused
+ */
+void BlindsStub::poll(void* context) {
+    for (int i = 0; i < MQTT_BURST; i++) {
+        unsigned long before = received;
+        client.loop();
+        if (received == before) break;
+    }
+    drain();
+#if METRICS
+
+    /**
+     * The diagnostics timer is armed here once a task is free if none
+     * was when setup() or diagnose() armed it
+     */
+    if (diagnosticsTimer < 0) diagnosticsTimer = scheduler.after(METRICS_PERIOD, diagnose, nullptr);
+    SoftAccessPoint::serve();
+#endif
+}
+
+/**
+ * @brief Called by the connection each time the MQTT session is
+ *        (re)established; a new session has no subscription
+ *
+ * @param context unused
+ */
+void BlindsStub::subscribe(void* context) {
+
+    /**
+     * The object topic depends on the address we were given
+     */
+    Address ip = Connection::address();
+    homeCommands.set(TOPIC_COMMANDS);
+    objectCommands.set(TOPIC_COMMANDS, ip.c_str());
+    channelCommands.set(objectCommands.c_str(), "+");
+    stateTopic.set(TOPIC_STATES, ip.c_str());
+    traceTopic.set(TOPIC_TRACE, ip.c_str());
+#if METRICS
+    diagnosticsTopic.set(TOPIC_DIAGNOSTICS, ip.c_str());
+#endif
+
+    /**
+     * Subscribe to topics
+     */
+    client.subscribe(homeCommands.c_str());
+    client.subscribe(objectCommands.c_str());
+    client.subscribe(channelCommands.c_str());
+    for (uint8_t i = 0; i < MAX_GROUPS; i++) {
+        if (*groupCommands[i].c_str()) client.subscribe(groupCommands[i].c_str());
+    }
+
+    /**
+     * Send debug signal 'READY' to mosquitto_sub; this also flushes what
+     * was kept while offline, including the latest state if it changed
+     */
+    bool offline = publisher.getPending();
+    publisher.send(TOPIC_STATES, STATE_DEVICE_READY, sizeof(STATE_DEVICE_READY) - 1, false);
+    if (!offline) publish();
+}
+
+/**
+ * @brief Writes the state message in compact JSON or in MessagePack,
+ *        as chosen by the controller; 'objects' lists the channels in
+ *        order
+ * 
+ * @param buffer 
+ * @param size 
+ * @return size_t length of the message, 0 if it did not fit
+ */
+size_t BlindsStub::serialize(char* buffer, size_t size) {
+    StaticJsonDocument<STATE_SIZE> doc;
+    const Repository& repos = Repository::cached();
+    doc["ip"] = WiFi.localIP();
+    doc["name"] = repos.getName();
+    doc["format"] = repos.getFormat() == WF_MSGPACK ? FORMAT_MSGPACK : FORMAT_JSON;
+    JsonArray objects = doc.createNestedArray("objects");
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        JsonObject object = objects.createNestedObject();
+        switch (blinds.getState(i)){
+            case BS_OPENING:
+                object["state"] = STATE_OPENING;
+                break;
+            case BS_OPENED:
+                object["state"] = STATE_OPENED;
+                break;
+            case BS_CLOSING:
+                object["state"] = STATE_CLOSING;
+                break;
+            case BS_CLOSED:
+                object["state"] = STATE_CLOSED;
+                break;
+        }
+        switch (blinds.getMode(i)) {
+            case BM_MANUAL:
+                object["mode"] = MODE_MANUAL;
+                break;
+            case BM_AUTOMATIC:
+                object["mode"] = MODE_AUTOMATIC;
+                break;
+        }
+        object["position"] = blinds.getPosition(i);
+    }
+    size_t length = repos.getFormat() == WF_MSGPACK ? serializeMsgPack(doc, buffer, size) : serializeJson(doc, buffer, size);
+    return length < size ? length : 0;
+}
+
+/**
+ * @brief Called by the publisher at most once per window; the state
+ *        is retained on the object topic so that a controller learns
+ *        it as soon as it subscribes
+ *
+ * @param context unused
+ */
+void BlindsStub::compose(void* context) {
+    METRIC_TIME(MT_PUBLISH);
+
+    /**
+     * The object topic is known once connected; the state is published
+     * on connection anyway
+     */
+    if (!*stateTopic.c_str()) return;
+    char json[MAX_MESSAGE];
+    size_t length = serialize(json, sizeof(json));
+    if (length) publisher.send(stateTopic.c_str(), json, length, true);
+}
+
+/**
+ * @brief Publish the state after a change; the changes of every
+ *        channel in one scheduler pass go out as one message
+ */
+void BlindsStub::publish() {
+    publisher.request();
+}
+
+/**
+ * @brief Delay of this device's reply to a broadcast query. The device
+ *        ID is hashed so that neighbouring IDs land far apart and the
+ *        fleet spreads evenly over the window.
+ *
+ * @param id device ID
+ * @param window in ms
+ * @return unsigned long delay in ms, below window
+ */
+unsigned long BlindsStub::jitter(uint32_t id, unsigned long window) {
+    if (window == 0) return 0;
+    id ^= id >> 16;
+    id *= 0x85ebca6b;
+    id ^= id >> 13;
+    id *= 0xc2b2ae35;
+    id ^= id >> 16;
+    return id % window;
+}
+
+/**
+ * @brief A query_objects on the home topic reaches every device at
+ *        once; the reply is delayed so that they do not all answer in
+ *        the same instant
+ *
+ * @param window in ms
+ */
+void BlindsStub::query(unsigned long window) {
+
+    /**
+     * A reply already scheduled answers this query too
+     */
+    if (replyTimer >= 0) return;
+    replyTimer = scheduler.after(jitter(ESP.getChipId(), window), reply, nullptr);
+    if (replyTimer < 0) reply(nullptr);
+}
+
+/**
+ * @brief Answer a query_objects with the state at the time of the reply
+ *
+ * @param context unused
+ */
+void BlindsStub::reply(void* context) {
+    replyTimer = -1;
+    char json[MAX_MESSAGE];
+    size_t length = serialize(json, sizeof(json));
+    if (length) publisher.send(TOPIC_STATES, json, length, false);
+}
+
+/**
+ * @brief Publish the trace as is, for tools/trace.py to decode; like
+ *        the diagnostics, it is not kept while the broker is unreachable
+ */
+void BlindsStub::dumpTrace() {
+    uint8_t dump[MAX_TRACE];
+    size_t length = Trace::dump(dump, sizeof(dump));
+    if (length && *traceTopic.c_str()) client.publish(traceTopic.c_str(), dump, length, false);
+}
+
+#if METRICS
+/**
+ * @brief Writes the diagnostics: the counters of the MQTT side, the
+ *        heap and the latency of the hot paths
+ *
+ * @param buffer
+ * @param size of the buffer
+ * @return size_t length written, 0 if the buffer is too small
+ */
+size_t BlindsStub::diagnostics(char* buffer, size_t size) {
+    size_t length = snprintf(buffer, size, "{\"uptime\":%lu,\"in\":%lu,\"out\":%lu,\"reconnects\":%lu,\"dropped\":%lu,",
+        millis() / 1000, received, publisher.getSent(), connection.getReconnects(),
+        publisher.getDropped() + commandQueue.getDropped());
+    if (length >= size) return 0;
+    size_t metrics = Metrics::serialize(buffer + length, size - length);
+    if (!metrics) return 0;
+    length += metrics;
+    if (length + 1 >= size) return 0;
+    buffer[length++] = '}';
+    buffer[length] = 0;
+    return length;
+}
+
+/**
+ * @brief Scheduler timer publishing the diagnostics once per period;
+ *        they are not worth keeping while the broker is unreachable.
+ *        poll() arms it again if no task was free
+ *
+ * @param context unused
+ */
+void BlindsStub::diagnose(void* context) {
+    diagnosticsTimer = scheduler.after(METRICS_PERIOD, diagnose, nullptr);
+    if (!connection.connected() || !*diagnosticsTopic.c_str()) return;
+    char json[MAX_DIAGNOSTICS];
+    size_t length = diagnostics(json, sizeof(json));
+    if (length) client.publish(diagnosticsTopic.c_str(), (const uint8_t*)json, length, false);
+}
+#endif
+
+/**
+ * @brief Saves the mode and the state of a channel so that they
+ *        survive a reset
+ *
+ * @param channel
+ */
+void BlindsStub::persist(uint8_t channel) {
+    Repository::saveState(channel, blinds.getMode(channel), blinds.getState(channel), blinds.getPosition(channel));
+}
+
+/**
+ * @brief Saves the travel times learned for a channel; a refinement of
+ *        less than TRAVEL_RESOLUTION in both directions is not worth a
+ *        write
+ *
+ * @param channel
+ */
+void BlindsStub::persistTravel(uint8_t channel) {
+    uint16_t opening = blinds.getTravel(channel, BS_OPENING);
+    uint16_t closing = blinds.getTravel(channel, BS_CLOSING);
+    uint16_t savedOpening, savedClosing;
+    if (Repository::loadTravel(channel, savedOpening, savedClosing) &&
+        abs(opening - savedOpening) < TRAVEL_RESOLUTION && abs(closing - savedClosing) < TRAVEL_RESOLUTION) return;
+    Repository::saveTravel(channel, opening, closing);
 }
 
 /**
@@ -149,71 +849,77 @@ void BlindsStub::setup() {
     Serial.begin(9600);
 
     /**
-     * Load required information from repository
+     * Required information from repository
      */
-    Repository repos;
-    repos.load();
-    String hostname = repos.getName();
-    String domain = (repos.getMQTTServer().c_str());
-    String port = (repos.getMQTTPort().c_str());
+    const Repository& repos = Repository::cached();
 
     /**
-     * Init. WiFi client
+     * Keys read from commands
      */
-    Serial.print("Connecting to WiFi");
-    WiFi.mode(WIFI_STA);
-    WiFi.hostname(hostname);
-    WiFi.begin(repos.getSSID(), repos.getPassword());
-    while (WiFi.status() != WL_CONNECTED) {
-        Serial.print(".");
-        delay(500);
-    }
-    Serial.println("");
-    Serial.print("Connected to WiFi: ");
-    Serial.print(repos.getSSID());
-    Serial.print(" using password: ");
-    Serial.println(repos.getPassword());
+    filter["cmd"] = true;
+    filter["mode"] = true;
+    filter["position"] = true;
+    filter["window"] = true;
+    filter["format"] = true;
+    filter["night"] = true;
+    filter["day"] = true;
+    filter["dwell"] = true;
+    filter["latitude"] = true;
+    filter["longitude"] = true;
+    filter["offset"] = true;
+    filter["rule"] = true;
+    filter["days"] = true;
+    filter["event"] = true;
+    filter["minute"] = true;
+    filter["group"] = true;
 
     /**
-     * Init. MQTT client
+     * Init. WiFi and MQTT clients; the connection comes up in the
+     * background and the blinds run meanwhile
      */
-    Serial.print("Connecting to MQTT");
-    client.setServer(domain.c_str(), port.toInt());
     client.setCallback(callback);
-    while (!client.connect(clientName().c_str())) {
-        Serial.print(".");
-        delay(500);
-    }
-    Serial.println("");
-    Serial.print("Connected to MQTT: ");
-    Serial.print(repos.getMQTTServer());
-    Serial.print(":");
-    Serial.println(repos.getMQTTPort());
+    client.setBufferSize(MQTT_BUFFER);
+    publisher.setup(compose, nullptr);
+    connection.setup(repos.getSSID(), repos.getPassword(), repos.getName(),
+        repos.getMQTTServer(), atoi(repos.getMQTTPort()), subscribe, nullptr);
+    connection.setPowerMode(POWER_MODE);
 
     /**
-     * Subscribe to topics
+     * The clock of the schedule is kept in UTC; the rules carry the
+     * offset of local time
      */
-    client.subscribe(homeTopic(TOPIC_COMMANDS).c_str());
-    client.subscribe(objectTopic(TOPIC_COMMANDS).c_str());
+    configTime(0, 0, SNTP_SERVER);
 
     /**
-     * Send debug signal 'READY' to mosquitto_sub
+     * Init. the blinds where they were left
      */
-    client.publish(homeTopic(TOPIC_STATES).c_str(), STATE_DEVICE_READY);
+    BlindsMode mode;
+    BlindsState state;
+    uint8_t position;
+    uint16_t opening, closing;
+    blinds.setPhotocell(repos.getPhotocell());
+    blinds.setup();
+    for (uint8_t i = 0; i < CHANNELS; i++) {
+        if (Repository::loadTravel(i, opening, closing)) blinds.setTravel(i, opening, closing);
+        if (Repository::loadState(i, mode, state, position)) blinds.restore(i, mode, state, position);
+    }
+    if (!Repository::loadSchedule(schedule)) memset(&schedule, 0, sizeof(schedule));
+    blinds.setSchedule(schedule);
+    if (!Repository::loadGroups(groups)) memset(&groups, 0, sizeof(groups));
+    listen();
+    scheduler.poll(MQTT_PERIOD, poll, nullptr);
 
     /**
-     * Init. the blinds
+     * Diagnostics go to the broker and to /metrics; a fleet booted at
+     * once spreads them over the period like the query replies
      */
-    blinds.setup();
+#if METRICS
+    diagnosticsTimer = scheduler.after(jitter(ESP.getChipId(), METRICS_PERIOD), diagnose, nullptr);
+    SoftAccessPoint::startMetrics();
+#endif
 }
 
 void BlindsStub::loop() {
-    client.loop();
-    blinds.loop();
+    scheduler.loop();
 }
 
-void BlindsStub::onSetMode(){publish();}
-void BlindsStub::onOpening(){publish();}
-void BlindsStub::onOpened(){publish();}
-void BlindsStub::onClosing(){publish();}
-void BlindsStub::onClosed(){publish();}
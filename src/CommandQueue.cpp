@@ -0,0 +1,149 @@
+/**
+ * @file CommandQueue.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief 
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <IoT3.h>
+
+/**
+ * Commands of the same group supersede each other
+ */
+#define CG_MOTION    1
+#define CG_MODE      2
+#define CG_QUERY     3
+#define CG_FORMAT    4
+#define CG_TRACE     5
+#define CG_PHOTOCELL 6
+#define CG_SCHEDULE  7
+#define CG_GROUPS    8
+
+/**
+ * @brief Construct a new CommandQueue:: CommandQueue object
+ */
+CommandQueue::CommandQueue() :
+    head(0), depth(0), highWater(0), coalesced(0), dropped(0) {}
+
+/**
+ * @brief Determines which commands a command supersedes: any motion
+ *        replaces the pending motion, and so on
+ * 
+ * @param command 
+ * @return uint8_t 
+ */
+uint8_t CommandQueue::group(BlindsCommand command) {
+    switch (command) {
+        case BC_OPEN:
+        case BC_CLOSE:
+        case BC_STOP:
+        case BC_SET_POSITION:
+        case BC_CALIBRATE:
+            return CG_MOTION;
+        case BC_SET_MODE:
+            return CG_MODE;
+        case BC_QUERY_OBJECTS:
+            return CG_QUERY;
+        case BC_SET_FORMAT:
+            return CG_FORMAT;
+        case BC_DUMP_TRACE:
+            return CG_TRACE;
+        case BC_SET_PHOTOCELL:
+            return CG_PHOTOCELL;
+        case BC_SET_SCHEDULE:
+        case BC_SET_RULE:
+            return CG_SCHEDULE;
+        case BC_JOIN:
+        case BC_LEAVE:
+            return CG_GROUPS;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Queue a command; the pending commands it supersedes are
+ *        removed so that the order of the others is kept. A command for
+ *        every channel supersedes those of each channel, not the reverse
+ * 
+ * @param command 
+ * @param argument mode, position, window or format
+ * @param channel or ALL_CHANNELS
+ * @return false if the queue is full and the command was dropped
+ */
+bool CommandQueue::push(BlindsCommand command, int16_t argument, uint8_t channel) {
+    uint8_t kind = group(command);
+    for (uint8_t i = 0; i < depth;) {
+        const PendingCommand& pending = ring[(head + i) % MAX_COMMANDS];
+        if (group(pending.command) != kind || (channel != ALL_CHANNELS && pending.channel != channel)) {
+            i++;
+            continue;
+        }
+
+        /**
+         * Close the gap left by the superseded command
+         */
+        for (uint8_t j = i; j + 1 < depth; j++) {
+            ring[(head + j) % MAX_COMMANDS] = ring[(head + j + 1) % MAX_COMMANDS];
+        }
+        depth--;
+        coalesced++;
+    }
+    if (depth == MAX_COMMANDS) {
+        dropped++;
+        return false;
+    }
+    PendingCommand& pending = ring[(head + depth) % MAX_COMMANDS];
+    pending.command = command;
+    pending.argument = argument;
+    pending.channel = channel;
+    depth++;
+    if (depth > highWater) highWater = depth;
+    return true;
+}
+
+/**
+ * @brief Take the oldest command
+ * 
+ * @param command 
+ * @return false if the queue is empty
+ */
+bool CommandQueue::pop(PendingCommand& command) {
+    if (depth == 0) return false;
+    command = ring[head];
+    head = (head + 1) % MAX_COMMANDS;
+    depth--;
+    return true;
+}
+
+/**
+ * @brief Number of commands waiting
+ * 
+ * @return uint8_t 
+ */
+uint8_t CommandQueue::getDepth() {return depth;}
+
+/**
+ * @brief Largest number of commands that waited at once since boot
+ * 
+ * @return uint8_t 
+ */
+uint8_t CommandQueue::getHighWater() {return highWater;}
+
+/**
+ * @brief Number of commands replaced by a newer one since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long CommandQueue::getCoalesced() {return coalesced;}
+
+/**
+ * @brief Number of commands dropped because the queue was full since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long CommandQueue::getDropped() {return dropped;}
@@ -0,0 +1,244 @@
+/**
+ * @file Connection.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <ESP8266WiFi.h>
+#include <PubSubClient.h>
+
+/**
+ * Connection polling period
+ */
+#define CONNECTION_PERIOD 100
+
+/**
+ * Reconnect backoff bounds; the delay doubles on every failed attempt
+ */
+#define BACKOFF_MIN   500
+#define BACKOFF_MAX 60000
+
+/**
+ * An attempt blocks the loop. The name of the broker is resolved in one
+ * poll, within DNS_TIMEOUT ms; the next poll connects to the address,
+ * the TCP handshake taking up to CONNECT_TIMEOUT ms and the answer of
+ * the broker up to SOCKET_TIMEOUT s. The worst stall, CONNECT_STALL ms,
+ * is 1.5 s; an attempt waits until no timer of the scheduler falls due
+ * within it, so that travels, ramps and end-stops never wait behind it.
+ * Only the polls run up to CONNECT_STALL late
+ */
+#define DNS_TIMEOUT     1000
+#define CONNECT_TIMEOUT 500
+#define SOCKET_TIMEOUT  1
+#define CONNECT_STALL   (CONNECT_TIMEOUT + SOCKET_TIMEOUT * 1000)
+
+extern Scheduler scheduler;
+
+/**
+ * @brief Construct a new Connection:: Connection object
+ *
+ * @param socket TCP client under the MQTT client
+ * @param client
+ */
+Connection::Connection(WiFiClient& socket, PubSubClient& client) :
+    socket(socket), client(client), state(CS_WIFI), retryAt(0), backoff(0),
+    reconnects(0), port(0), resolved(false), onConnect(nullptr), context(nullptr) {
+    server[0] = 0;
+}
+
+/**
+ * @brief Start connecting; the connection then lives on its own from
+ *        the scheduler
+ *
+ * @param ssid
+ * @param password
+ * @param hostname
+ * @param server MQTT broker, copied because PubSubClient keeps the pointer
+ * @param port
+ * @param onConnect called after each successful MQTT connection
+ * @param context passed back to onConnect
+ */
+void Connection::setup(const char* ssid, const char* password, const char* hostname,
+    const char* server, uint16_t port, TaskCallback onConnect, void* context) {
+    strncpy(this->server, server, sizeof(this->server) - 1);
+    this->server[sizeof(this->server) - 1] = 0;
+    this->port = port;
+    this->onConnect = onConnect;
+    this->context = context;
+
+    /**
+     * Devices powered up together must not retry together
+     */
+    randomSeed(ESP.random());
+
+    /**
+     * The SDK keeps the station associated by itself once begun
+     */
+    Serial.println("Connecting to WiFi");
+    WiFi.mode(WIFI_STA);
+    WiFi.hostname(hostname);
+    WiFi.begin(ssid, password);
+
+    socket.setTimeout(CONNECT_TIMEOUT);
+    client.setSocketTimeout(SOCKET_TIMEOUT);
+    scheduler.poll(CONNECTION_PERIOD, poll, this);
+}
+
+/**
+ * @brief Scheduler task running the connection state machine
+ *
+ * @param context the connection
+ */
+void Connection::poll(void* context) {
+    ((Connection*)context)->loop();
+}
+
+/**
+ * @brief Plan the next MQTT attempt with an exponential backoff; the
+ *        delay is drawn in [backoff/2, backoff] so that a fleet
+ *        disconnected by the same broker restart spreads out
+ */
+void Connection::retry() {
+    backoff = backoff ? backoff * 2 : BACKOFF_MIN;
+    if (backoff > BACKOFF_MAX) backoff = BACKOFF_MAX;
+    retryAt = millis() + random(backoff / 2, backoff + 1);
+}
+
+/**
+ * @brief Connection state machine
+ */
+void Connection::loop() {
+    if (WiFi.status() != WL_CONNECTED) {
+        if (state != CS_WIFI) {
+            Serial.println("WiFi lost");
+            if (state == CS_CONNECTED) reconnects++;
+            client.disconnect();
+            state = CS_WIFI;
+        }
+        return;
+    }
+
+    switch (state) {
+        case CS_WIFI:
+
+            /**
+             * Associated; try the broker after a random delay
+             */
+            Serial.print("Connected to WiFi: ");
+            Serial.println(address().c_str());
+            state = CS_MQTT;
+            backoff = 0;
+            retry();
+            break;
+        case CS_MQTT:
+            if ((long)(millis() - retryAt) < 0 || scheduler.quiet() < CONNECT_STALL) break;
+            if (!resolved) {
+
+                /**
+                 * PubSubClient would resolve the name itself, for up to
+                 * 10 s; the address is kept until an attempt fails
+                 */
+                IPAddress ip;
+                if (!WiFi.hostByName(server, ip, DNS_TIMEOUT)) {
+                    retry();
+                    break;
+                }
+                client.setServer(ip, port);
+                resolved = true;
+                break;
+            }
+            if (client.connect(address().c_str())) {
+                Serial.print("Connected to MQTT: ");
+                Serial.println(server);
+                state = CS_CONNECTED;
+                backoff = 0;
+                if (onConnect) onConnect(context);
+            } else {
+                resolved = false;
+                retry();
+            }
+            break;
+        case CS_CONNECTED:
+            if (!client.connected()) {
+
+                /**
+                 * Broker dropped us
+                 */
+                Serial.println("MQTT lost");
+                reconnects++;
+                state = CS_MQTT;
+                retry();
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Determines whether the MQTT session is up
+ *
+ * @return true
+ * @return false
+ */
+bool Connection::connected() {return state == CS_CONNECTED;}
+
+/**
+ * @brief Number of times the MQTT session was lost since boot
+ *
+ * @return unsigned long
+ */
+unsigned long Connection::getReconnects() {return reconnects;}
+
+/**
+ * @brief Choose how the chip saves power between the scheduled tasks;
+ *        the station stays associated and the MQTT session open in
+ *        every mode. The keepalive applies from the next session
+ *
+ * @param mode
+ */
+void Connection::setPowerMode(PowerMode mode) {
+    switch (mode) {
+        case PM_AWAKE:
+            WiFi.setSleepMode(WIFI_NONE_SLEEP);
+            client.setKeepAlive(MQTT_KEEPALIVE);
+            scheduler.setPollPeriod(0);
+            break;
+        case PM_MODEM_SLEEP:
+
+            /**
+             * The radio sleeps between beacons, the CPU keeps polling
+             */
+            WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+            client.setKeepAlive(MQTT_KEEPALIVE);
+            scheduler.setPollPeriod(0);
+            break;
+        case PM_LIGHT_SLEEP:
+
+            /**
+             * The SDK puts the chip to sleep in delay() until the next
+             * task is due; fewer pings keep the session alive
+             */
+            WiFi.setSleepMode(WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL);
+            client.setKeepAlive(POWER_KEEPALIVE);
+            scheduler.setPollPeriod(POWER_PERIOD);
+            break;
+    }
+}
+
+/**
+ * @brief Address given to the station; it names the device on the
+ *        broker and in its topics
+ *
+ * @return Address
+ */
+Address Connection::address() {
+    IPAddress ip = WiFi.localIP();
+    Address address;
+    address.appendf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    return address;
+}
@@ -0,0 +1,442 @@
+/**
+ * @file HttpServer.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+
+/**
+ * A session that makes no progress for this long is dropped
+ */
+#define HTTP_TIMEOUT 5000
+
+/**
+ * Largest request body accepted (the configuration form)
+ */
+#define MAX_HTTP_BODY 512
+
+/**
+ * Bytes moved per session and per loop, so that one fast client
+ * cannot starve the others
+ */
+#define HTTP_CHUNK 128
+
+/**
+ * @brief Reason phrase of the status codes used by the firmware
+ */
+static const char* reason(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        default: return "Internal Server Error";
+    }
+}
+
+/**
+ * @brief Value of a hexadecimal digit, 0 for anything else
+ */
+static uint8_t hex(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+/**
+ * @brief Value of a header line if it has the given name
+ *
+ * @param line
+ * @param name including the colon
+ * @return const char* the trimmed value or nullptr
+ */
+static const char* header(const char* line, const char* name) {
+    size_t length = strlen(name);
+    if (strncasecmp(line, name, length)) return nullptr;
+    line += length;
+    while (*line == ' ' || *line == '\t') line++;
+    return line;
+}
+
+/**
+ * @brief Construct a new HttpServer:: HttpServer object
+ *
+ * @param port
+ */
+HttpServer::HttpServer(uint16_t port) :
+    server(port), count(0), notFound(nullptr), reader(nullptr), requests(0) {
+    for (int i = 0; i < MAX_HTTP_SESSIONS; i++) sessions[i].state = HS_FREE;
+}
+
+/**
+ * @brief Registers the handler of a path
+ *
+ * @param uri
+ * @param handler called once the request is complete
+ * @param field called for each field of an urlencoded body, as it arrives
+ */
+void HttpServer::on(const char* uri, HttpHandler handler, HttpField field) {
+    if (count == MAX_HTTP_ROUTES) return;
+    routes[count].uri = uri;
+    routes[count].handler = handler;
+    routes[count].field = field;
+    count++;
+}
+
+void HttpServer::onNotFound(HttpHandler handler) {notFound = handler;}
+
+void HttpServer::begin() {
+    server.begin();
+    server.setNoDelay(true);
+}
+
+/**
+ * @brief Moves every session along without waiting on any of them
+ */
+void HttpServer::loop() {
+    accept();
+    for (int i = 0; i < MAX_HTTP_SESSIONS; i++) {
+        HttpSession& session = sessions[i];
+        switch (session.state) {
+            case HS_FREE:
+                break;
+            case HS_REQUEST:
+            case HS_HEADERS:
+            case HS_BODY:
+                receive(session);
+                break;
+            case HS_RESPONSE:
+                transmit(session);
+                break;
+        }
+        if (session.state != HS_FREE && millis() - session.since > HTTP_TIMEOUT) {
+
+            /**
+             * Stalled client; tell it if it is still sending its request
+             */
+            if (session.state == HS_RESPONSE) close(session);
+            else send(session, 408, "text/plain", "");
+        }
+    }
+}
+
+/**
+ * @brief Takes pending connections while there are free sessions; the
+ *        others wait in the TCP stack
+ */
+void HttpServer::accept() {
+    for (int i = 0; i < MAX_HTTP_SESSIONS; i++) {
+        HttpSession& session = sessions[i];
+        if (session.state != HS_FREE) continue;
+        session.client = server.available();
+        if (!session.client) return;
+        session.state = HS_REQUEST;
+        session.since = millis();
+        session.method = HM_OTHER;
+        session.uri[0] = 0;
+        session.etag[0] = 0;
+        session.route = -1;
+        session.fields = 0;
+        session.remaining = 0;
+        session.length = 0;
+        session.overflow = false;
+        session.inValue = false;
+        session.escape = 0;
+        session.nameLength = 0;
+        session.valueLength = 0;
+        session.responseLength = 0;
+        session.body = nullptr;
+        session.bodyLength = 0;
+        session.sent = 0;
+    }
+}
+
+/**
+ * @brief Parses what the client sent so far, at most one chunk
+ */
+void HttpServer::receive(HttpSession& session) {
+    if (!session.client.connected()) {
+        close(session);
+        return;
+    }
+    if (session.state == HS_BODY && !claim(session)) return;
+    if (session.state == HS_BODY && session.length) {
+
+        /**
+         * Body bytes that came with the headers are parsed first
+         */
+        for (uint16_t i = 0; i < session.length && session.state == HS_BODY; i++) {
+            parse(session, session.request.line[i]);
+        }
+        session.length = 0;
+        return;
+    }
+    uint8_t chunk[HTTP_CHUNK];
+    int length = session.client.read(chunk, sizeof(chunk));
+    if (length <= 0) return;
+    session.since = millis();
+    for (int i = 0; i < length && session.state != HS_RESPONSE; i++) {
+        if (session.state == HS_BODY) {
+            if (!claim(session)) {
+
+                /**
+                 * Another form is being parsed; the line buffer is free
+                 * and large enough to keep the rest of the chunk
+                 */
+                memcpy(session.request.line, chunk + i, length - i);
+                session.length = length - i;
+                return;
+            }
+            parse(session, (char)chunk[i]);
+            continue;
+        }
+        if (chunk[i] == '\n') {
+            if (session.length && session.request.line[session.length - 1] == '\r') session.length--;
+            session.request.line[session.length] = 0;
+            parse(session);
+            session.length = 0;
+            session.overflow = false;
+        } else if (session.length < MAX_HTTP_LINE - 1) {
+            session.request.line[session.length++] = chunk[i];
+        } else {
+            session.overflow = true;
+        }
+    }
+}
+
+/**
+ * @brief Form handlers write the fields straight into shared state, so
+ *        one form body is parsed at a time; the others wait their turn
+ *
+ * @return true if the session may parse its body
+ */
+bool HttpServer::claim(HttpSession& session) {
+    if (session.route < 0 || !routes[session.route].field) return true;
+    if (reader && reader != &session) return false;
+    reader = &session;
+    return true;
+}
+
+/**
+ * @brief Parses the request line or a header line
+ */
+void HttpServer::parse(HttpSession& session) {
+    const char* line = session.request.line;
+    const char* value;
+    if (session.state == HS_REQUEST) {
+        if (!*line) return;
+        if (session.overflow) {
+            send(session, 414, "text/plain", "");
+            return;
+        }
+        if (!strncmp(line, "GET ", 4)) session.method = HM_GET;
+        else if (!strncmp(line, "HEAD ", 5)) session.method = HM_HEAD;
+        else if (!strncmp(line, "POST ", 5)) session.method = HM_POST;
+        const char* uri = strchr(line, ' ');
+        if (!uri) {
+            send(session, 400, "text/plain", "");
+            return;
+        }
+        uri++;
+        size_t length = strcspn(uri, " ?");
+        if (length >= MAX_HTTP_URI) {
+            send(session, 414, "text/plain", "");
+            return;
+        }
+        memcpy(session.uri, uri, length);
+        session.uri[length] = 0;
+        for (int i = 0; i < count; i++) {
+            if (!strcmp(routes[i].uri, session.uri)) session.route = i;
+        }
+        session.state = HS_HEADERS;
+    } else if (*line) {
+
+        /**
+         * Only the headers the handlers need are kept
+         */
+        if (session.overflow) return;
+        if ((value = header(line, "Content-Length:"))) {
+            session.remaining = atol(value);
+        } else if ((value = header(line, "If-None-Match:"))) {
+            strncpy(session.etag, value, MAX_HTTP_ETAG - 1);
+            session.etag[MAX_HTTP_ETAG - 1] = 0;
+        }
+    } else if (session.remaining > MAX_HTTP_BODY || session.remaining < 0) {
+        send(session, 413, "text/plain", "");
+    } else if (session.remaining == 0) {
+        dispatch(session);
+    } else {
+        session.state = HS_BODY;
+    }
+}
+
+/**
+ * @brief Decodes one byte of an application/x-www-form-urlencoded body
+ */
+void HttpServer::parse(HttpSession& session, char c) {
+    session.remaining--;
+    if (session.escape) {
+        session.code = (session.code << 4) | hex(c);
+        if (--session.escape == 0) store(session, session.code);
+    } else if (c == '%') {
+        session.escape = 2;
+        session.code = 0;
+    } else if (c == '&') {
+        field(session);
+    } else if (c == '=' && !session.inValue) {
+        session.inValue = true;
+    } else {
+        store(session, c == '+' ? ' ' : c);
+    }
+    if (session.remaining == 0) {
+        field(session);
+        dispatch(session);
+    }
+}
+
+/**
+ * @brief Appends a decoded byte to the field name or value; longer
+ *        ones are truncated
+ */
+void HttpServer::store(HttpSession& session, char c) {
+    if (session.inValue) {
+        if (session.valueLength < MAX_HTTP_VALUE - 1) session.request.value[session.valueLength++] = c;
+    } else {
+        if (session.nameLength < MAX_HTTP_NAME - 1) session.request.name[session.nameLength++] = c;
+    }
+}
+
+/**
+ * @brief Hands a complete field over to the route
+ */
+void HttpServer::field(HttpSession& session) {
+    if (session.nameLength) {
+        session.request.name[session.nameLength] = 0;
+        session.request.value[session.valueLength] = 0;
+        if (session.route >= 0 && routes[session.route].field) {
+            routes[session.route].field(session, session.request.name, session.request.value);
+        }
+        session.fields++;
+    }
+    session.nameLength = 0;
+    session.valueLength = 0;
+    session.inValue = false;
+    session.escape = 0;
+}
+
+/**
+ * @brief Runs the handler of a complete request
+ */
+void HttpServer::dispatch(HttpSession& session) {
+    if (reader == &session) reader = nullptr;
+    requests++;
+    session.state = HS_RESPONSE;
+    HttpHandler handler = session.route >= 0 ? routes[session.route].handler : notFound;
+    if (handler) handler(session);
+    if (!session.responseLength) send(session, 404, "text/plain", "");
+}
+
+/**
+ * @brief Queues a response held in RAM; it is copied, so the body may
+ *        live on the stack of the handler. A body that does not fit
+ *        after the headers is refused with a 500 rather than cut short
+ *        of its Content-Length
+ *
+ * @param session
+ * @param code
+ * @param type content type, nullptr for none
+ * @param body
+ * @param headers extra header lines, each ending with CRLF
+ */
+void HttpServer::send(HttpSession& session, int code, const char* type, const char* body, const char* headers) {
+    size_t length = strlen(body);
+    send_P(session, code, type, nullptr, length, headers);
+    if (length > (size_t)(MAX_HTTP_RESPONSE - session.responseLength)) {
+        send(session, 500, "text/plain", "Response too large");
+        return;
+    }
+    if (session.method == HM_HEAD) return;
+    memcpy(session.response + session.responseLength, body, length);
+    session.responseLength += length;
+}
+
+/**
+ * @brief Queues a response whose body stays in flash until it is sent
+ *
+ * @param session
+ * @param code
+ * @param type content type, nullptr for none
+ * @param body in PROGMEM, nullptr if the caller appends it
+ * @param length of the body
+ * @param headers extra header lines, each ending with CRLF
+ */
+void HttpServer::send_P(HttpSession& session, int code, const char* type, const uint8_t* body, size_t length, const char* headers) {
+    if (reader == &session) reader = nullptr;
+    int size = snprintf(session.response, MAX_HTTP_RESPONSE,
+        "HTTP/1.1 %d %s\r\n%s%s%sContent-Length: %u\r\nConnection: close\r\n%s\r\n",
+        code, reason(code), type ? "Content-Type: " : "", type ? type : "", type ? "\r\n" : "",
+        (unsigned)length, headers);
+    session.responseLength = size < MAX_HTTP_RESPONSE ? size : MAX_HTTP_RESPONSE - 1;
+    session.body = session.method == HM_HEAD ? nullptr : body;
+    session.bodyLength = session.body ? length : 0;
+    session.sent = 0;
+    session.state = HS_RESPONSE;
+    session.since = millis();
+}
+
+/**
+ * @brief Writes as much of the response as the socket takes
+ */
+void HttpServer::transmit(HttpSession& session) {
+    if (!session.client.connected()) {
+        close(session);
+        return;
+    }
+    size_t total = session.responseLength + session.bodyLength;
+    size_t room = session.client.availableForWrite();
+    if (room > HTTP_CHUNK) room = HTTP_CHUNK;
+    if (room && session.sent < total) {
+        uint8_t chunk[HTTP_CHUNK];
+        size_t length = 0;
+        if (session.sent < session.responseLength) {
+            length = session.responseLength - session.sent;
+            if (length > room) length = room;
+            memcpy(chunk, session.response + session.sent, length);
+        } else {
+            length = total - session.sent;
+            if (length > room) length = room;
+            memcpy_P(chunk, session.body + session.sent - session.responseLength, length);
+        }
+        length = session.client.write(chunk, length);
+        if (length) session.since = millis();
+        session.sent += length;
+    }
+    if (session.sent == total) close(session);
+}
+
+/**
+ * @brief Frees a session; the TCP stack finishes sending on its own
+ */
+void HttpServer::close(HttpSession& session) {
+    if (reader == &session) reader = nullptr;
+    session.client.stop();
+    session.state = HS_FREE;
+}
+
+/**
+ * @brief Number of requests handled since boot
+ *
+ * @return unsigned long
+ */
+unsigned long HttpServer::getRequests() {return requests;}
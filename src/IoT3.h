@@ -13,15 +13,44 @@
  */
 
 #include <Arduino.h>
-#include <ESP8266WebServer.h>
-#include <Servo.h>
+#include <ESP8266WiFi.h>
+#include <stdarg.h>
+#include <time.h>
 
 /**
- * Define the board to be used. If ESP12E is ommited then the
- * ESP01-1M is used. As of now, the definition is only used to
- * define GPIO pins according to choosen board
+ * Marks the globals holding the state of the device; the host stand-in
+ * of Arduino.h gathers them so that a simulator can run many devices
  */
-#define ESP12E
+#ifndef DEVICE_STATE
+#define DEVICE_STATE
+#endif
+
+/**
+ * The board is selected by the build: the esp12e environment defines
+ * ESP12E, the esp01_1m one ESP01. See the board traits below
+ */
+#if defined(ESP12E) == defined(ESP01)
+#error "Define exactly one board: ESP12E or ESP01"
+#endif
+
+/**
+ * Number of blinds driven by one board; the pins of each channel are
+ * given by the board traits
+ */
+#ifndef CHANNELS
+#ifdef ESP12E
+#define CHANNELS 4
+#else
+#define CHANNELS 1
+#endif
+#endif
+
+/**
+ * Channel of a command sent to the object topic itself, and the mask
+ * of every channel
+ */
+#define ALL_CHANNELS 0xff
+#define CHANNEL_MASK ((1 << CHANNELS) - 1)
 
 /**
  * Define FORMAT_FIRMWARE if you wish to upload the firmware
@@ -52,13 +81,175 @@
 #define MAX_NAME        32
 #define MAX_MQTT_SERVER 32
 #define MAX_MQTT_PORT   32
+#define MAX_TOPIC       64
+#define MAX_IP          16
+#define MAX_RECORD      240
+
+/**
+ * Repository description shown after the portal form is saved; every
+ * field at its longest fits
+ */
+#define MAX_DESCRIPTION 320
+
+/**
+ * Scheduler limits; the idle wait is bounded so that the loop still
+ * comes back regularly when no task is registered
+ */
+#define MAX_TASKS       10
+#define MAX_IDLE        1000
+
+/**
+ * Power saving between the scheduled tasks; the SDK default is modem
+ * sleep. In light sleep the polls share POWER_PERIOD so that they wake
+ * the chip together, and the station only listens every
+ * POWER_LISTEN_INTERVAL beacons. A command then waits at most 307 ms
+ * at the access point (3 beacons of 102.4 ms) and POWER_PERIOD in the
+ * socket: 557 ms before it is applied, against 10 ms awake
+ */
+#ifndef POWER_MODE
+#define POWER_MODE PM_MODEM_SLEEP
+#endif
+#define POWER_PERIOD          250
+#define POWER_LISTEN_INTERVAL 3
+#define POWER_KEEPALIVE       60
+
+/**
+ * Commands waiting between the MQTT callback and the blinds
+ */
+#define MAX_COMMANDS    8
+
+/**
+ * Outbound messages kept while the broker is unreachable; a state
+ * message takes about 100 bytes plus 53 per channel
+ */
+#define MAX_OUTBOX      4
+#define MAX_MESSAGE     (100 + 53 * CHANNELS)
+
+/**
+ * HTTP server limits; every buffer is allocated once per session. A
+ * response holds the headers and the largest generated body, the
+ * metrics
+ */
+#define MAX_HTTP_SESSIONS 4
+#define MAX_HTTP_ROUTES   4
+#define MAX_HTTP_LINE     128
+#define MAX_HTTP_URI      32
+#define MAX_HTTP_ETAG     24
+#define MAX_HTTP_NAME     16
+#define MAX_HTTP_VALUE    64
+#define MAX_HTTP_RESPONSE 1152
+
+/**
+ * Runtime metrics, published on the diagnostics topic and served at
+ * /metrics; build with METRICS=0 to leave them out entirely. Latencies
+ * fall in power-of-two buckets of microseconds, the last one open. The
+ * diagnostics fit every counter at its largest value
+ */
+#ifndef METRICS
+#define METRICS 1
+#endif
+#define METRIC_BUCKETS  12
+#define MAX_DIAGNOSTICS 1024
+
+/**
+ * Photocell filter: each sample is the median of a burst of readings,
+ * averaged over about 2^PHOTOCELL_SMOOTHING samples in 1/16 steps. The
+ * thresholds are ADC readings and the dwell is in seconds
+ */
+#define PHOTOCELL_OVERSAMPLE 5
+#define PHOTOCELL_SMOOTHING  3
+#define MAX_LIGHT            1023
+#define MAX_DWELL            3600
+
+/**
+ * Schedule of the automatic mode: MAX_RULES rules of the week in local
+ * time, at a time of the day or at an offset from sunrise or sunset.
+ * The clock is set over SNTP and counts as set once past CLOCK_VALID;
+ * until then, and for the channels no rule drives, the automatic mode
+ * follows the photocell. The schedule timer sleeps until the next rule
+ * boundary, SCHEDULE_HORIZON ms at most, and looks at the clock every
+ * SCHEDULE_RETRY ms while it is not set. The offset of local time is in
+ * minutes
+ */
+#define MAX_RULES        8
+#ifndef SNTP_SERVER
+#define SNTP_SERVER      "pool.ntp.org"
+#endif
+#define CLOCK_VALID      1577836800
+#define SCHEDULE_HORIZON 3600000
+#define SCHEDULE_RETRY   10000
+#define MAX_OFFSET       840
+
+/**
+ * Groups a device can join, such as the rooms of a house; a command on
+ * the topic of a group reaches every member at once. A name holds at
+ * most MAX_GROUP - 1 characters
+ */
+#define MAX_GROUPS 4
+#define MAX_GROUP  16
+
+/**
+ * Travel times in ms, learned per channel and direction: a calibration
+ * step or a refinement outside of MIN_TRAVEL..MAX_TRAVEL is dropped, and
+ * a calibration step still running after MAX_TRAVEL is given up. While
+ * a channel with an end-stop moves, its switch is read every
+ * END_STOP_PERIOD; a travel to an end may run past its learned time by
+ * 1/END_STOP_OVERRUN of it until the switch closes. Learned times are
+ * saved again once they moved by TRAVEL_RESOLUTION
+ */
+#define MIN_TRAVEL        200
+#define MAX_TRAVEL        60000
+#define END_STOP_PERIOD   20
+#define END_STOP_OVERRUN  2
+#define TRAVEL_RESOLUTION 20
 
+/**
+ * Servo waveform: a continuous rotation servo stands still on a pulse
+ * of ACTUATOR_NEUTRAL us every ACTUATOR_FRAME us and runs at full speed
+ * ACTUATOR_SPAN us away from it, the shorter pulses closing the blinds.
+ * Speeds are in 1/ACTUATOR_FULL of the full speed; it takes
+ * ACTUATOR_ACCELERATION ms to get there from standstill and
+ * ACTUATOR_DECELERATION ms back, in steps of ACTUATOR_STEP ms, one
+ * frame. A stopped servo is held on its neutral pulse with
+ * ACTUATOR_HOLD, its pin is released otherwise
+ */
+#define ACTUATOR_FRAME   20000
+#define ACTUATOR_NEUTRAL 1500
+#define ACTUATOR_SPAN    500
+#define ACTUATOR_FULL    1000
+#define ACTUATOR_STEP    20
+#ifndef ACTUATOR_ACCELERATION
+#define ACTUATOR_ACCELERATION 200
+#endif
+#ifndef ACTUATOR_DECELERATION
+#define ACTUATOR_DECELERATION 200
+#endif
+#ifndef ACTUATOR_HOLD
+#define ACTUATOR_HOLD 0
+#endif
+
+/**
+ * Transitions kept in the trace ring; a dump is a header followed by
+ * the entries, oldest first
+ */
+#ifndef TRACE_ENTRIES
+#define TRACE_ENTRIES   64
+#endif
+#define TRACE_HEADER    8
+#define TRACE_ENTRY     12
+#define MAX_TRACE       (TRACE_HEADER + TRACE_ENTRIES * TRACE_ENTRY)
+
+class PubSubClient;
+class Scheduler;
+class Connection;
+class Topic;
+class CommandQueue;
+class Publisher;
+class Storage;
+class HttpServer;
 class Repository;
-class BlindsObserver;
-class Firmware;
 class SoftAccessPoint;
 class BlindsStub;
-class Blinds;
 
 enum BlindsMode {
     BM_MANUAL = 1,
@@ -70,7 +261,9 @@ enum BlindsEvent {
     BE_CLOSE = 2,
     BE_TIMEOUT = 3,
     BE_DAYTIME = 4,
-    BE_NIGHTTIME = 5
+    BE_NIGHTTIME = 5,
+    BE_STOP = 6,
+    BE_END_STOP = 7
 };
 
 enum BlindsState {
@@ -80,6 +273,490 @@ enum BlindsState {
     BS_CLOSED = 4
 };
 
+enum BlindsCommand {
+    BC_NONE = 0,
+    BC_OPEN = 1,
+    BC_CLOSE = 2,
+    BC_SET_MODE = 3,
+    BC_QUERY_OBJECTS = 4,
+    BC_STOP = 5,
+    BC_SET_POSITION = 6,
+    BC_SET_FORMAT = 7,
+    BC_DUMP_TRACE = 8,
+    BC_SET_PHOTOCELL = 9,
+    BC_CALIBRATE = 10,
+    BC_SET_SCHEDULE = 11,
+    BC_SET_RULE = 12,
+    BC_JOIN = 13,
+    BC_LEAVE = 14
+};
+
+enum TraceSource {
+    TS_MQTT = 1,
+    TS_PHOTOCELL = 2,
+    TS_TIMEOUT = 3,
+    TS_END_STOP = 4,
+    TS_SCHEDULE = 5
+};
+
+/**
+ * Trace events beyond BlindsEvent, for the commands that do not go
+ * through Blinds::setState()
+ */
+#define TE_SET_MODE     16
+#define TE_SET_POSITION 17
+#define TE_CALIBRATE    18
+#define TE_SCHEDULE     19
+
+/**
+ * Trace entry flags
+ */
+#define TF_IGNORED 0x01
+
+enum MetricTimer {
+    MT_LOOP = 0,
+    MT_BLINDS = 1,
+    MT_CALLBACK = 2,
+    MT_PUBLISH = 3
+};
+
+#define METRIC_TIMERS 4
+
+enum PowerMode {
+    PM_AWAKE = 1,
+    PM_MODEM_SLEEP = 2,
+    PM_LIGHT_SLEEP = 3
+};
+
+enum WireFormat {
+    WF_JSON = 0,
+    WF_MSGPACK = 1
+};
+
+typedef void (*TaskCallback)(void* context);
+
+/**
+ * class is responsable to build a string in a fixed buffer, on the
+ * stack or in an object, instead of on the heap; what does not fit is
+ * cut off
+ */
+template <size_t N>
+class FixedString {
+    char text[N];
+    size_t length;
+public:
+    FixedString() : length(0) {text[0] = 0;}
+    FixedString(const char* s) : length(0) {text[0] = 0; append(s);}
+    FixedString& append(const char* s) {
+        while (*s && length + 1 < N) text[length++] = *s++;
+        text[length] = 0;
+        return *this;
+    }
+    __attribute__((format(printf, 2, 3))) FixedString& appendf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(text + length, N - length, format, args);
+        va_end(args);
+        if (n > 0) length = length + n < N ? length + n : N - 1;
+        return *this;
+    }
+    FixedString& operator+=(const char* s) {return append(s);}
+    const char* c_str() const {return text;}
+    size_t size() const {return length;}
+    bool full() const {return length + 1 >= N;}
+    void clear() {length = 0; text[0] = 0;}
+};
+
+/**
+ * @brief Dotted address of the station
+ */
+typedef FixedString<MAX_IP> Address;
+
+#if METRICS
+/**
+ * class is responsable to keep the latency of the hot paths and the
+ * state of the heap; recording a sample takes a few microseconds
+ */
+class Metrics {
+    struct Timer {
+        unsigned long count;
+        unsigned long max;
+        unsigned long long total;
+        unsigned long buckets[METRIC_BUCKETS];
+    };
+    static Timer timers[METRIC_TIMERS];
+public:
+    static void record(MetricTimer timer, unsigned long us);
+    static size_t serialize(char* buffer, size_t size);
+};
+
+/**
+ * @brief Records the time spent in the enclosing block
+ */
+class MetricScope {
+    MetricTimer timer;
+    unsigned long start;
+public:
+    MetricScope(MetricTimer timer) : timer(timer), start(micros()) {}
+    ~MetricScope() {Metrics::record(timer, micros() - start);}
+};
+
+#define METRIC_TIME(timer) MetricScope metricScope(timer)
+#else
+#define METRIC_TIME(timer)
+#endif
+
+/**
+ * class is responsable to run timers and periodic tasks when they are
+ * due and to give the CPU back to the WiFi stack in between
+ */
+class Scheduler {
+    struct Task {
+        TaskCallback callback;
+        void* context;
+        unsigned long deadline;
+        unsigned long period;
+        unsigned long poll;
+    };
+    Task tasks[MAX_TASKS];
+    unsigned long pollPeriod;
+    static bool due(unsigned long deadline, unsigned long now);
+    static unsigned long align(unsigned long time, unsigned long period);
+    int add(unsigned long delay, unsigned long period, TaskCallback callback, void* context);
+public:
+    Scheduler();
+    int every(unsigned long period, TaskCallback callback, void* context);
+    int poll(unsigned long period, TaskCallback callback, void* context);
+    int after(unsigned long delay, TaskCallback callback, void* context);
+    void cancel(int id);
+    void setPollPeriod(unsigned long period);
+    unsigned long idle();
+    unsigned long quiet();
+    void loop();
+};
+
+enum ConnectionState {
+    CS_WIFI = 1,
+    CS_MQTT = 2,
+    CS_CONNECTED = 3
+};
+
+/**
+ * class is responsable to bring the WiFi and MQTT connections up and
+ * to bring them back when they drop, blocking the loop for a bounded
+ * time per attempt and never while a timer is about to fall due
+ */
+class Connection {
+    WiFiClient& socket;
+    PubSubClient& client;
+    ConnectionState state;
+    unsigned long retryAt;
+    unsigned long backoff;
+    unsigned long reconnects;
+    char server[MAX_MQTT_SERVER];
+    uint16_t port;
+    bool resolved;
+    TaskCallback onConnect;
+    void* context;
+    static void poll(void* context);
+    void retry();
+public:
+    Connection(WiFiClient& socket, PubSubClient& client);
+    void setup(const char* ssid, const char* password, const char* hostname,
+        const char* server, uint16_t port, TaskCallback onConnect, void* context);
+    void loop();
+    bool connected();
+    unsigned long getReconnects();
+    void setPowerMode(PowerMode mode);
+    static Address address();
+};
+
+/**
+ * class is responsable to hold an MQTT topic name in a fixed buffer
+ */
+class Topic {
+    char name[MAX_TOPIC];
+    uint8_t length;
+public:
+    Topic();
+    void set(const char* base, const char* suffix = nullptr);
+    const char* c_str() const;
+    bool matches(const char* topic, size_t length) const;
+    int child(const char* topic, size_t length) const;
+};
+
+/**
+ * @brief Command received over MQTT, waiting to be applied
+ */
+struct PendingCommand {
+    BlindsCommand command;
+    int16_t argument;
+    uint8_t channel;
+};
+
+/**
+ * class is responsable to hold the commands received over MQTT until
+ * the blinds apply them; a command replaces any pending one it
+ * supersedes, so a burst collapses to its outcome
+ */
+class CommandQueue {
+    PendingCommand ring[MAX_COMMANDS];
+    uint8_t head;
+    uint8_t depth;
+    uint8_t highWater;
+    unsigned long coalesced;
+    unsigned long dropped;
+    static uint8_t group(BlindsCommand command);
+public:
+    CommandQueue();
+    bool push(BlindsCommand command, int16_t argument, uint8_t channel);
+    bool pop(PendingCommand& command);
+    uint8_t getDepth();
+    uint8_t getHighWater();
+    unsigned long getCoalesced();
+    unsigned long getDropped();
+};
+
+/**
+ * @brief Message waiting for the broker
+ */
+struct Outgoing {
+    const char* topic;
+    bool retained;
+    uint16_t length;
+    char payload[MAX_MESSAGE];
+};
+
+/**
+ * class is responsable to send the outbound MQTT messages: it limits
+ * state messages to one per window and keeps the latest message of
+ * each topic until the broker can take it
+ */
+class Publisher {
+    PubSubClient& client;
+    Outgoing outbox[MAX_OUTBOX];
+    uint8_t pending;
+    TaskCallback compose;
+    void* context;
+    unsigned long last;
+    int timer;
+    unsigned long sent;
+    unsigned long bytes;
+    unsigned long coalesced;
+    unsigned long dropped;
+    static void fire(void* context);
+    void remove(uint8_t index);
+public:
+    Publisher(PubSubClient& client);
+    void setup(TaskCallback compose, void* context);
+    void request();
+    bool send(const char* topic, const char* payload, size_t length, bool retained);
+    void flush();
+    uint8_t getPending();
+    unsigned long getSent();
+    unsigned long getBytes();
+    unsigned long getCoalesced();
+    unsigned long getDropped();
+};
+
+enum RecordType {
+    RT_CONFIG = 1,
+    RT_STATE = 2,
+    RT_COMMIT = 3,
+    RT_TRAVEL = 4,
+    RT_SCHEDULE = 5,
+    RT_GROUPS = 6
+};
+
+#define RECORD_TYPES 6
+
+struct RecordHeader;
+
+/**
+ * class is responsable to keep small records in an append-only,
+ * CRC-checked log spread over two flash sectors; a sector is only
+ * erased when the log wraps, instead of on every save
+ */
+class Storage {
+    struct Live {
+        uint32_t offset;
+        uint16_t length;
+        uint32_t sequence;
+    };
+    struct Scan {
+        uint32_t end;
+        uint32_t last;
+        uint32_t commit;
+        bool committed;
+        bool torn;
+    };
+    uint32_t first;
+    bool mounted;
+    uint8_t active;
+    uint32_t offset;
+    uint32_t sequence;
+    unsigned long erases;
+    Live live[RECORD_TYPES];
+    uint32_t address(uint8_t sector, uint32_t offset);
+    bool check(uint8_t sector, uint32_t offset, RecordHeader& header);
+    void scan(uint8_t sector, Scan& scan);
+    bool append(RecordType type, const void* data, uint16_t length);
+    bool compact();
+public:
+    Storage(uint32_t sector);
+    void mount();
+    bool read(RecordType type, void* data, size_t size);
+    bool write(RecordType type, const void* data, size_t size);
+    unsigned long getErases();
+};
+
+enum HttpMethod {
+    HM_OTHER = 0,
+    HM_GET = 1,
+    HM_HEAD = 2,
+    HM_POST = 3
+};
+
+enum HttpState {
+    HS_FREE = 0,
+    HS_REQUEST = 1,
+    HS_HEADERS = 2,
+    HS_BODY = 3,
+    HS_RESPONSE = 4
+};
+
+/**
+ * @brief One client of the HTTP server. The request is parsed in
+ *        place into fixed buffers; the parser buffers are reused for
+ *        the response once the request is complete
+ */
+struct HttpSession {
+    WiFiClient client;
+    HttpState state;
+    unsigned long since;
+    HttpMethod method;
+    char uri[MAX_HTTP_URI];
+    char etag[MAX_HTTP_ETAG];
+    int8_t route;
+    uint8_t fields;
+    long remaining;
+    uint16_t length;
+    bool overflow;
+    bool inValue;
+    uint8_t escape;
+    char code;
+    uint8_t nameLength;
+    uint8_t valueLength;
+    union {
+        struct {
+            char line[MAX_HTTP_LINE];
+            char name[MAX_HTTP_NAME];
+            char value[MAX_HTTP_VALUE];
+        } request;
+        char response[MAX_HTTP_RESPONSE];
+    };
+    uint16_t responseLength;
+    const uint8_t* body;
+    size_t bodyLength;
+    size_t sent;
+};
+
+typedef void (*HttpHandler)(HttpSession& session);
+typedef void (*HttpField)(HttpSession& session, const char* name, const char* value);
+
+/**
+ * class is responsable to serve several HTTP clients at once without
+ * ever waiting on one of them; each loop() moves every session along
+ * by what its socket can take
+ */
+class HttpServer {
+    struct Route {
+        const char* uri;
+        HttpHandler handler;
+        HttpField field;
+    };
+    WiFiServer server;
+    HttpSession sessions[MAX_HTTP_SESSIONS];
+    Route routes[MAX_HTTP_ROUTES];
+    uint8_t count;
+    HttpHandler notFound;
+    HttpSession* reader;
+    unsigned long requests;
+    void accept();
+    void receive(HttpSession& session);
+    bool claim(HttpSession& session);
+    void parse(HttpSession& session);
+    void parse(HttpSession& session, char c);
+    void store(HttpSession& session, char c);
+    void field(HttpSession& session);
+    void dispatch(HttpSession& session);
+    void transmit(HttpSession& session);
+    void close(HttpSession& session);
+public:
+    HttpServer(uint16_t port);
+    void on(const char* uri, HttpHandler handler, HttpField field = nullptr);
+    void onNotFound(HttpHandler handler);
+    void begin();
+    void loop();
+    void send(HttpSession& session, int code, const char* type, const char* body, const char* headers = "");
+    void send_P(HttpSession& session, int code, const char* type, const uint8_t* body, size_t length, const char* headers = "");
+    unsigned long getRequests();
+};
+
+/**
+ * @brief Thresholds of the photocell filter; a field at 0 stands for
+ *        the default of the board
+ */
+struct PhotocellSettings {
+    uint16_t night;
+    uint16_t day;
+    uint16_t dwell;
+};
+
+enum ScheduleEvent {
+    SE_TIME = 1,
+    SE_SUNRISE = 2,
+    SE_SUNSET = 3
+};
+
+/**
+ * @brief Rule of the schedule: on the days of its mask, bit 0 being
+ *        Sunday, the channels of its mask go to a position at a minute
+ *        of the local day, or at minutes from sunrise or sunset. A rule
+ *        without days is unused
+ */
+struct ScheduleRule {
+    uint8_t days;
+    uint8_t event;
+    int16_t minute;
+    uint8_t position;
+    uint8_t channels;
+};
+
+/**
+ * @brief Location in 1/100 degrees, north and east positive, offset of
+ *        local time from UTC in minutes, and the rules
+ */
+struct ScheduleSettings {
+    int16_t latitude;
+    int16_t longitude;
+    int16_t offset;
+    ScheduleRule rules[MAX_RULES];
+};
+
+/**
+ * @brief Groups the channels of the device belong to; a group without
+ *        a name is unused
+ */
+struct Group {
+    char name[MAX_GROUP];
+    uint8_t channels;
+};
+
+struct GroupSettings {
+    Group groups[MAX_GROUPS];
+};
+
 /**
  * class is responsable to abstract the media storage used by 
  * the firmware to load and save persistant informations 
@@ -91,86 +768,358 @@ class Repository {
     char mqttServer[MAX_MQTT_SERVER];
     char mqttPort[MAX_MQTT_PORT];
     bool ok;
+    uint8_t format;
+    PhotocellSettings photocell;
+    static Repository cache;
+    static bool loaded;
+    static void copy(char* field, size_t size, const char* str);
+    void clear();
 public:
     int offset(void* field);
     Repository();
+    static const Repository& cached();
     bool load();
-    String getSSID();
-    String getPassword();
-    String getName();
-    String getMQTTServer();
-    String getMQTTPort();
-    void setSSID(const String& str);
-    void setPassword(const String& str);
-    void setName(const String& str);
-    void setMQTTServer(const String& str);
-    void setMQTTPort(const String& str);
+    bool isValid() const;
+    const char* getSSID() const;
+    const char* getPassword() const;
+    const char* getName() const;
+    const char* getMQTTServer() const;
+    const char* getMQTTPort() const;
+    WireFormat getFormat() const;
+    const PhotocellSettings& getPhotocell() const;
+    void setSSID(const char* str);
+    void setPassword(const char* str);
+    void setName(const char* str);
+    void setMQTTServer(const char* str);
+    void setMQTTPort(const char* str);
+    void setFormat(WireFormat format);
+    void setPhotocell(const PhotocellSettings& settings);
     void save();
-    String toString();
+    static bool loadState(uint8_t channel, BlindsMode& mode, BlindsState& state, uint8_t& position);
+    static void saveState(uint8_t channel, BlindsMode mode, BlindsState state, uint8_t position);
+    static bool loadTravel(uint8_t channel, uint16_t& opening, uint16_t& closing);
+    static void saveTravel(uint8_t channel, uint16_t opening, uint16_t closing);
+    static bool loadSchedule(ScheduleSettings& settings);
+    static void saveSchedule(const ScheduleSettings& settings);
+    static bool loadGroups(GroupSettings& settings);
+    static void saveGroups(const GroupSettings& settings);
+    FixedString<MAX_DESCRIPTION> toString() const;
+};
+
+class SoftAccessPoint {
+    static void handleRoot(HttpSession& session);
+    static void handleValues(HttpSession& session);
+    static void handleField(HttpSession& session, const char* name, const char* value);
+    static void handleForm(HttpSession& session);
+    static void handleNotFound(HttpSession& session);
+#if METRICS
+    static void handleMetrics(HttpSession& session);
+#endif
+    static HttpServer server;
+    static Repository form;
+public:
+    SoftAccessPoint();
+#if METRICS
+    static void startMetrics();
+    static void serve();
+#endif
+    void setup();
+    void loop();
+};
+
+/**
+ * class is responsable to run the blinds over MQTT; it is also the
+ * observer of the blinds, called directly on each transition
+ */
+class BlindsStub {
+    static void callback(char* topic, byte* payload, unsigned int length);
+    static void poll(void* context);
+    static void drain();
+    static void subscribe(void* context);
+    static BlindsCommand lookup(const char* cmd);
+    static bool binary(const byte* payload, unsigned int length);
+    static void setFormat(WireFormat format);
+    static void setPhotocell();
+    static void setSchedule();
+    static void setGroups();
+    static int find(const char* name, bool create);
+    static void listen();
+    static bool collective(BlindsCommand command);
+    static void dispatch(BlindsCommand command, int16_t argument, uint8_t channels);
+    static size_t serialize(char* buffer, size_t size);
+    static void compose(void* context);
+    static void publish();
+    static void query(unsigned long window);
+    static void reply(void* context);
+    static void persist(uint8_t channel);
+    static void persistTravel(uint8_t channel);
+    static void apply(uint8_t channel, const PendingCommand& pending);
+#if METRICS
+    static void diagnose(void* context);
+#endif
+    static void dumpTrace();
+public:
+    BlindsStub();
+    static unsigned long jitter(uint32_t id, unsigned long window);
+#if METRICS
+    static size_t diagnostics(char* buffer, size_t size);
+#endif
+    void setup();
+    void loop();
+    void onSetMode(uint8_t channel) {persist(channel); publish();}
+    void onOpening(uint8_t channel) {publish();}
+    void onOpened(uint8_t channel) {persist(channel); publish();}
+    void onClosing(uint8_t channel) {publish();}
+    void onClosed(uint8_t channel) {persist(channel); publish();}
+    void onTravel(uint8_t channel) {persistTravel(channel);}
 };
 
-class BlindsObserver {
+/**
+ * @brief Transition of one channel as kept in the trace. The layout is
+ *        the dump format read by tools/trace.py; the position is the
+ *        one requested by a set_position, the one reached otherwise
+ */
+struct TraceEntry {
+    uint32_t time;
+    uint8_t channel;
+    uint8_t event;
+    uint8_t from;
+    uint8_t to;
+    uint8_t mode;
+    uint8_t position;
+    uint8_t flags;
+    uint8_t repeat;
+};
+
+/**
+ * class is responsable to keep the last transitions of the blinds in
+ * a binary ring, without any formatting; a repeated transition only
+ * counts up the previous entry of its channel
+ */
+class Trace {
+    static TraceEntry ring[TRACE_ENTRIES];
+    static uint16_t head;
+    static uint16_t count;
+    static uint16_t last[CHANNELS];
 public:
-    virtual void onSetMode() = 0;
-    virtual void onOpening() = 0;
-    virtual void onOpened() = 0;
-    virtual void onClosing() = 0;
-    virtual void onClosed() = 0;
+    static void record(uint8_t channel, TraceSource source, uint8_t event,
+        uint8_t from, uint8_t to, uint8_t mode, uint8_t position, uint8_t flags);
+    static size_t dump(uint8_t* buffer, size_t size);
 };
 
-class Firmware {
+/**
+ * class is responsable to tell the night from the day out of the noisy
+ * readings of one photocell: a burst of readings gives its median, a
+ * fixed-point moving average smooths the medians, and the decision only
+ * flips once the average has stayed past the other threshold for the
+ * whole dwell time
+ */
+class Photocell {
+    uint16_t level;
+    bool night;
+    bool primed;
+    unsigned long since;
+    static uint16_t median(uint16_t* readings);
 public:
-    virtual void setup() = 0;
-    virtual void loop() = 0;
+    Photocell();
+    bool update(uint8_t pin, uint16_t night, uint16_t day, unsigned long dwell);
+    uint16_t getLevel() const;
 };
 
-class SoftAccessPoint : public Firmware {
-    static void handleRoot();
-    static void handleForm();
-    static void handleNotFound();
-    static ESP8266WebServer server;
+/**
+ * class is responsable to turn one servo through the waveform generator
+ * of the core, whose pulses are timed by a hardware timer whatever the
+ * WiFi stack does. The speed follows ramps stepped by the scheduler,
+ * and the distance run is integrated from the speeds commanded
+ */
+class Actuator {
+    uint8_t pin;
+    int16_t speed;
+    int16_t target;
+    bool running;
+    unsigned long sampled;
+    long distance;
+    void advance(unsigned long now);
+    void slew(unsigned long elapsed);
+    void pulse();
 public:
-    SoftAccessPoint();
-    virtual void setup();
-    virtual void loop();
+    Actuator();
+    void attach(uint8_t pin);
+    void drive(int16_t speed);
+    void stop();
+    void brake();
+    void update();
+    void mark();
+    bool ramping();
+    int16_t getSpeed();
+    long travelled();
+    unsigned long stopping();
 };
 
-class BlindsStub : 
-    public Firmware, 
-    public BlindsObserver {
-    static void callback(char* topic, byte* payload, unsigned int length);
-    static String clientName();
-    static String homeTopic(const String& topic);
-    static String objectTopic(const String& topic);
-    static void publish();
+/**
+ * class is responsable to tell where the blinds of each channel should
+ * be at a given time of the week. Sunrise and sunset are computed on the
+ * device from the location, to a minute or two; times are UTC seconds
+ */
+class Schedule {
+    ScheduleSettings settings;
+    bool solar() const;
+    bool at(const ScheduleRule& rule, long day, bool sun, time_t rise, time_t set, time_t& time) const;
 public:
-    BlindsStub();
-    virtual void setup();
-    virtual void loop();
-    virtual void onSetMode();
-    virtual void onOpening();
-    virtual void onOpened();
-    virtual void onClosing();
-    virtual void onClosed();
-};
-
-class Blinds : public Firmware {
-    BlindsObserver& observer;
-    BlindsMode mode;
-    BlindsState state;
+    Schedule();
+    void set(const ScheduleSettings& settings);
+    const ScheduleSettings& get() const;
+    bool empty() const;
+    bool drives(uint8_t channel) const;
+    bool sun(long day, time_t& rise, time_t& set) const;
+    time_t next(time_t now) const;
+    int position(uint8_t channel, time_t now) const;
+    static bool valid(time_t now);
+};
+
+enum CalibrationStep {
+    CP_NONE = 0,
+    CP_HOMING = 1,
+    CP_OPENING = 2,
+    CP_CLOSING = 3
+};
+
+/**
+ * @brief Motion of one channel; positions are in units of the travel
+ *        of the board, times in ms. The end-stop is wired once it was
+ *        seen closed, and the channel homed while it rests where its
+ *        switch stopped it
+ */
+struct Channel {
+    uint8_t state;
+    uint8_t mode;
+    uint16_t position;
+    uint16_t target;
+    uint16_t origin;
+    uint16_t opening;
+    uint16_t closing;
+    uint8_t calibration;
+    bool released;
+    bool wired;
+    bool homed;
     unsigned long startTime;
-    Servo servo;
-public:
-    Blinds(BlindsObserver& observer);
-    void setState(BlindsEvent event);
-    void setMode(BlindsMode mode);
-    void open();
-    void close();
-    BlindsMode getMode();
-    BlindsState getState();
-    bool isNightTime();
-    virtual void setup();
-    virtual void loop();
 };
 
+/**
+ * Unused pin in the board traits
+ */
+#define NO_PIN 0xff
+
+/**
+ * End-stops, one input per channel in channel order; each one is pulled
+ * up and grounded by a switch at either end of the travel, both wired
+ * in parallel. Build with, say, -D END_STOP_PINS=4,5,16,0 when they are
+ * fitted; there are none by default
+ */
+#ifndef END_STOP_PINS
+#define END_STOP_PINS NO_PIN
+#endif
+
+/**
+ * @brief Pin of a channel out of a list of pins given to the build
+ */
+constexpr uint8_t nthPin(uint8_t channel, uint8_t a, uint8_t b = NO_PIN, uint8_t c = NO_PIN, uint8_t d = NO_PIN) {
+    return channel == 0 ? a : channel == 1 ? b : channel == 2 ? c : d;
+}
+
+/**
+ * @brief Pins and calibration of the ESP-12E board: four channels
+ *        sharing the analog input
+ */
+struct Esp12eBoard {
+    static constexpr uint8_t servoPin(uint8_t channel) {
+        return channel == 0 ? 15 : channel == 1 ? 13 : channel == 2 ? 12 : 14;
+    }
+    static constexpr uint8_t photocellPin(uint8_t channel) {return A0;}
+    static constexpr uint8_t endStopPin(uint8_t channel) {return nthPin(channel, END_STOP_PINS);}
+    static constexpr int nightThreshold = 150;
+    static constexpr int dayThreshold = 200;
+    static constexpr unsigned long dwell = 30;
+    static constexpr unsigned long travel = 2000;
+};
+
+/**
+ * @brief Pins and calibration of the ESP-01 1M board: one channel
+ */
+struct Esp01Board {
+    static constexpr uint8_t servoPin(uint8_t channel) {return 2;}
+    static constexpr uint8_t photocellPin(uint8_t channel) {return A0;}
+    static constexpr uint8_t endStopPin(uint8_t channel) {return nthPin(channel, END_STOP_PINS);}
+    static constexpr int nightThreshold = 150;
+    static constexpr int dayThreshold = 200;
+    static constexpr unsigned long dwell = 30;
+    static constexpr unsigned long travel = 2000;
+};
+
+#ifdef ESP12E
+typedef Esp12eBoard Board;
+#else
+typedef Esp01Board Board;
+#endif
+
+/**
+ * class is responsable to drive the servos of the blinds. The board and
+ * the observer are known at compile time so that the pins are constants
+ * and the observer calls are direct. Board::travel is fully opened;
+ * each channel learns how many ms it takes to get there and back
+ */
+template <class Board, class Observer>
+class BasicBlinds {
+    Observer& observer;
+    Channel channels[CHANNELS];
+    Actuator actuators[CHANNELS];
+    Photocell photocells[CHANNELS];
+    PhotocellSettings photocell;
+    Schedule schedule;
+    int timer;
+    int alarm;
+    static void sample(void* context);
+    static void tick(void* context);
+    static void wake(void* context);
+    unsigned long duration(uint8_t channel);
+    unsigned long where(uint8_t channel);
+    unsigned long left(uint8_t channel);
+    bool endStop(uint8_t channel);
+    bool overrun(uint8_t channel);
+    void arm();
+    void plan();
+    void follow();
+    bool scheduled(uint8_t channel);
+    void spin(uint8_t channel, unsigned long target);
+    void move(uint8_t channel, unsigned long target);
+    void halt(uint8_t channel);
+    void reach(uint8_t channel);
+    void step(uint8_t channel);
+    void abort(uint8_t channel);
+    void trace(uint8_t channel, TraceSource source, uint8_t event, uint8_t from, uint16_t target, uint8_t position);
+public:
+    BasicBlinds(Observer& observer);
+    void setState(uint8_t channel, BlindsEvent event);
+    void setMode(uint8_t channel, BlindsMode mode);
+    void setPosition(uint8_t channel, uint8_t percent);
+    void restore(uint8_t channel, BlindsMode mode, BlindsState state, uint8_t percent);
+    void open(uint8_t channel);
+    void close(uint8_t channel);
+    BlindsMode getMode(uint8_t channel);
+    BlindsState getState(uint8_t channel);
+    uint8_t getPosition(uint8_t channel);
+    bool isNightTime(uint8_t channel);
+    void setPhotocell(const PhotocellSettings& settings);
+    uint16_t getLight(uint8_t channel);
+    void setSchedule(const ScheduleSettings& settings);
+    void calibrate(uint8_t channel);
+    bool isCalibrating(uint8_t channel);
+    void setTravel(uint8_t channel, uint16_t opening, uint16_t closing);
+    uint16_t getTravel(uint8_t channel, BlindsState direction);
+    void setup();
+    void loop();
+};
+
+typedef BasicBlinds<Board, BlindsStub> Blinds;
+
 #endif
\ No newline at end of file
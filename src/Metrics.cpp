@@ -0,0 +1,69 @@
+/**
+ * @file Metrics.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Runtime metrics of the hot paths and of the heap
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+
+#if METRICS
+
+/**
+ * Name of each timer in the diagnostics, in MetricTimer order
+ */
+static const char* const names[METRIC_TIMERS] = {"loop", "blinds", "callback", "publish"};
+
+/**
+ * Program variables
+ */
+DEVICE_STATE Metrics::Timer Metrics::timers[METRIC_TIMERS];
+
+/**
+ * @brief Adds a sample to a timer. Bucket i holds the samples from 2^i
+ *        to 2^(i+1) us, the first one everything below 2 us and the
+ *        last one everything above
+ *
+ * @param timer
+ * @param us duration of the sample
+ */
+void Metrics::record(MetricTimer timer, unsigned long us) {
+    Timer& t = timers[timer];
+    t.count++;
+    t.total += us;
+    if (us > t.max) t.max = us;
+    uint8_t bucket = METRIC_BUCKETS - 1;
+    if (!(us >> (METRIC_BUCKETS - 1))) bucket = 31 - __builtin_clz((uint32_t)us | 1);
+    t.buckets[bucket]++;
+}
+
+/**
+ * @brief Writes the heap state and the timers as JSON members, without
+ *        the enclosing braces; trailing empty buckets are left out
+ *
+ * @param buffer
+ * @param size of the buffer
+ * @return size_t length written, 0 if the buffer is too small
+ */
+size_t Metrics::serialize(char* buffer, size_t size) {
+    size_t length = snprintf(buffer, size, "\"heap\":%u,\"block\":%u,\"fragmentation\":%u",
+        (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMaxFreeBlockSize(), (unsigned)ESP.getHeapFragmentation());
+    for (uint8_t i = 0; i < METRIC_TIMERS && length < size; i++) {
+        const Timer& t = timers[i];
+        length += snprintf(buffer + length, size - length, ",\"%s\":{\"n\":%lu,\"mean\":%lu,\"max\":%lu,\"histogram\":[",
+            names[i], t.count, t.count ? (unsigned long)(t.total / t.count) : 0, t.max);
+        uint8_t used = METRIC_BUCKETS;
+        while (used && !t.buckets[used - 1]) used--;
+        for (uint8_t j = 0; j < used && length < size; j++) {
+            length += snprintf(buffer + length, size - length, j ? ",%lu" : "%lu", t.buckets[j]);
+        }
+        if (length < size) length += snprintf(buffer + length, size - length, "]}");
+    }
+    return length < size ? length : 0;
+}
+
+#endif
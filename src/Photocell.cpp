@@ -0,0 +1,93 @@
+/**
+ * @file Photocell.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Night and day out of the readings of a photocell
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+
+/**
+ * The average keeps 4 bits of fraction
+ */
+#define LEVEL_SHIFT 4
+
+/**
+ * @brief Construct a new Photocell:: Photocell object
+ */
+Photocell::Photocell() : level(0), night(false), primed(false), since(0) {}
+
+/**
+ * @brief Median of a burst by insertion sort; a short spike of the ADC
+ *        or of the light is left out
+ *
+ * @param readings PHOTOCELL_OVERSAMPLE of them, sorted in place
+ * @return uint16_t
+ */
+uint16_t Photocell::median(uint16_t* readings) {
+    for (uint8_t i = 1; i < PHOTOCELL_OVERSAMPLE; i++) {
+        uint16_t reading = readings[i];
+        uint8_t j = i;
+        for (; j > 0 && readings[j - 1] > reading; j--) readings[j] = readings[j - 1];
+        readings[j] = reading;
+    }
+    return readings[PHOTOCELL_OVERSAMPLE / 2];
+}
+
+/**
+ * @brief Takes a sample and decides whether it is the night. The first
+ *        sample decides alone so that a device booting at night stays
+ *        closed; then it takes a level below night or above day for
+ *        dwell seconds in a row to flip
+ *
+ * @param pin analog input
+ * @param night threshold, below it is the night
+ * @param day threshold, above it is the day; not below night
+ * @param dwell in seconds
+ * @return true at night
+ */
+bool Photocell::update(uint8_t pin, uint16_t night, uint16_t day, unsigned long dwell) {
+    uint16_t readings[PHOTOCELL_OVERSAMPLE];
+    for (uint8_t i = 0; i < PHOTOCELL_OVERSAMPLE; i++) readings[i] = analogRead(pin);
+    uint16_t sample = median(readings) << LEVEL_SHIFT;
+    unsigned long now = millis();
+    if (!primed) {
+        level = sample;
+        this->night = level < (night << LEVEL_SHIFT);
+        primed = true;
+        since = now;
+        return this->night;
+    }
+
+    /**
+     * Exponential moving average in fixed point: the level moves by
+     * 1/2^PHOTOCELL_SMOOTHING of the way to the sample
+     */
+    level += ((int32_t)sample - level) >> PHOTOCELL_SMOOTHING;
+
+    /**
+     * Between the thresholds, or back on the side of the decision, the
+     * dwell starts over
+     */
+    bool crossed = this->night ? level > (day << LEVEL_SHIFT) : level < (night << LEVEL_SHIFT);
+    if (!crossed) {
+        since = now;
+        return this->night;
+    }
+    if (now - since >= dwell * 1000) {
+        this->night = !this->night;
+        since = now;
+    }
+    return this->night;
+}
+
+/**
+ * @brief Filtered reading of the photocell
+ *
+ * @return uint16_t 0 to MAX_LIGHT
+ */
+uint16_t Photocell::getLevel() const {return level >> LEVEL_SHIFT;}
@@ -0,0 +1,84 @@
+#ifndef PORTAL_H
+#define PORTAL_H
+
+/**
+ * @file Portal.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Configuration portal page, gzip compressed
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * Generated from web/portal.html by tools/portal.py; do not edit
+ */
+
+#include <Arduino.h>
+
+#define PORTAL_ETAG "\"09dd5ffd07d1e3af\""
+
+static const uint8_t PORTAL_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x56, 0x6d, 0x6f, 0xdb, 0x36,
+    0x10, 0xfe, 0xee, 0x5f, 0x71, 0xfb, 0x30, 0xc8, 0x06, 0x22, 0x2b, 0x49, 0x37, 0xb4, 0x70, 0x64,
+    0x7d, 0x68, 0xeb, 0x01, 0xc1, 0xd0, 0xc5, 0x4d, 0x32, 0x0c, 0xc5, 0x30, 0x0c, 0x94, 0x78, 0xb2,
+    0xd8, 0x52, 0xa4, 0x46, 0x52, 0x96, 0x8d, 0xa2, 0xff, 0x7d, 0x47, 0x52, 0x4e, 0xbc, 0x64, 0x1d,
+    0xb0, 0x79, 0x41, 0x20, 0xbe, 0x1d, 0x1f, 0x1e, 0x9f, 0xe7, 0x8e, 0xe7, 0xfc, 0x9b, 0xb7, 0x37,
+    0x6f, 0xee, 0x3f, 0xac, 0x57, 0xd0, 0xb8, 0x56, 0x16, 0x93, 0xfc, 0xd0, 0x20, 0xe3, 0xd4, 0xb4,
+    0xe8, 0x18, 0x54, 0x0d, 0x33, 0x16, 0xdd, 0x32, 0xe9, 0x5d, 0x9d, 0xbe, 0x4a, 0x0e, 0xd3, 0x8a,
+    0xb5, 0xb8, 0x4c, 0xb6, 0x02, 0x87, 0x4e, 0x1b, 0x97, 0x40, 0xa5, 0x95, 0x43, 0x45, 0x66, 0x83,
+    0xe0, 0xae, 0x59, 0x72, 0xdc, 0x8a, 0x0a, 0xd3, 0x30, 0x38, 0x03, 0xa1, 0x84, 0x13, 0x4c, 0xa6,
+    0xb6, 0x62, 0x12, 0x97, 0x17, 0x1e, 0xc4, 0x09, 0x27, 0xb1, 0xb8, 0x29, 0x3f, 0x62, 0xe5, 0xe0,
+    0x16, 0x3b, 0x6d, 0x85, 0xd3, 0x66, 0x9f, 0x67, 0x71, 0x61, 0x92, 0x5b, 0xb7, 0xf7, 0x6d, 0xa9,
+    0xf9, 0x1e, 0x3e, 0x4f, 0x80, 0xfe, 0x6a, 0x3a, 0x22, 0xad, 0x59, 0x2b, 0xe4, 0x7e, 0x01, 0xc9,
+    0xad, 0x2e, 0xb5, 0xd3, 0xc9, 0x19, 0x58, 0xa6, 0x6c, 0x6a, 0xd1, 0x88, 0xfa, 0x6a, 0xf2, 0x65,
+    0x32, 0xaf, 0xb5, 0x69, 0x53, 0xa3, 0x87, 0x71, 0x13, 0x17, 0xb6, 0x93, 0x8c, 0x36, 0xd4, 0x12,
+    0x77, 0xde, 0x40, 0xb2, 0x12, 0xe5, 0xb8, 0x18, 0xdc, 0x5b, 0xc0, 0xc5, 0xf9, 0xf9, 0xb7, 0xb4,
+    0xc2, 0x8c, 0x13, 0x95, 0xc4, 0x71, 0xad, 0x64, 0xd5, 0xa7, 0x8d, 0xd1, 0xbd, 0xe2, 0x69, 0xa5,
+    0xa5, 0x36, 0x0b, 0x18, 0x1a, 0xe1, 0xf0, 0xea, 0x78, 0xe3, 0xe5, 0xab, 0xf3, 0x6e, 0x17, 0x67,
+    0x3a, 0xc6, 0xb9, 0x50, 0x9b, 0x05, 0x7c, 0xff, 0x30, 0xd5, 0x32, 0xb3, 0x11, 0x6a, 0x01, 0xac,
+    0x77, 0x3a, 0xce, 0x94, 0x7a, 0x97, 0xda, 0x86, 0x71, 0x3d, 0x2c, 0x80, 0xcc, 0x20, 0xbd, 0xa4,
+    0xcf, 0xa5, 0xef, 0xf9, 0x8e, 0xd9, 0x94, 0x6c, 0x7a, 0x7e, 0x06, 0xe3, 0xff, 0xfc, 0xbb, 0x59,
+    0xb8, 0x90, 0x50, 0x5d, 0xef, 0xec, 0xc1, 0x2b, 0x6d, 0x38, 0x9a, 0xd4, 0x30, 0x2e, 0x7a, 0xbb,
+    0x80, 0x97, 0xcf, 0x8f, 0x7f, 0x7a, 0xfa, 0x65, 0x17, 0xae, 0x9d, 0x67, 0x23, 0xa1, 0x79, 0x36,
+    0xaa, 0xeb, 0x99, 0xa5, 0x66, 0xbc, 0x75, 0x11, 0x36, 0xe5, 0x9e, 0x3d, 0x20, 0x81, 0x1b, 0xcd,
+    0x97, 0x09, 0x89, 0x42, 0xca, 0xa2, 0xaa, 0xdc, 0xbe, 0x23, 0xb1, 0x59, 0xd7, 0x49, 0x51, 0x31,
+    0x27, 0xb4, 0xca, 0x76, 0xe9, 0x30, 0x0c, 0x69, 0xe0, 0xba, 0x37, 0x92, 0x4c, 0x34, 0x47, 0x9e,
+    0x00, 0xab, 0xfc, 0xea, 0x32, 0xc9, 0xfc, 0x56, 0xbf, 0x9a, 0x25, 0x11, 0x38, 0x80, 0x37, 0x17,
+    0x7f, 0x27, 0x38, 0xcd, 0x1e, 0x99, 0xbc, 0x28, 0x7e, 0x11, 0x3f, 0x08, 0x78, 0x63, 0x90, 0x53,
+    0x38, 0x51, 0xd0, 0x58, 0xb2, 0x78, 0x71, 0x64, 0xd1, 0x15, 0x6b, 0x89, 0xcc, 0xe2, 0x19, 0x39,
+    0xe6, 0xd0, 0x80, 0x6b, 0x10, 0xee, 0xee, 0xae, 0xdf, 0x02, 0x53, 0x3c, 0x0c, 0x3a, 0x66, 0xed,
+    0x40, 0x34, 0xd1, 0x80, 0x39, 0x52, 0x4a, 0x4a, 0x28, 0x11, 0x7a, 0x8b, 0x34, 0xa3, 0x7d, 0x9c,
+    0x2a, 0xef, 0x01, 0x75, 0xbd, 0xf1, 0xb5, 0xc7, 0x50, 0xe8, 0xf2, 0xac, 0x3b, 0x3a, 0x83, 0x8b,
+    0x2d, 0x54, 0x92, 0x70, 0x96, 0xc9, 0x21, 0x9c, 0x8e, 0xee, 0x11, 0x4c, 0x62, 0x18, 0xd1, 0xea,
+    0x32, 0xb1, 0x56, 0xf0, 0xa4, 0xf0, 0x3e, 0x2c, 0xf2, 0x2c, 0xcc, 0x3f, 0xb1, 0x0d, 0x0a, 0x1e,
+    0x00, 0xa3, 0x9c, 0x09, 0x44, 0x4e, 0x1d, 0xee, 0x88, 0x62, 0xc1, 0x47, 0x94, 0x31, 0xad, 0x22,
+    0xe2, 0xa3, 0x3f, 0x19, 0x39, 0xf4, 0x9f, 0xdd, 0x3b, 0xf0, 0x91, 0x14, 0xeb, 0xb1, 0xf7, 0xef,
+    0xdd, 0x7c, 0xc0, 0x08, 0xae, 0x3e, 0x8e, 0xa2, 0xbb, 0x8f, 0x63, 0x4a, 0xb5, 0x0a, 0x1b, 0x2d,
+    0x29, 0x46, 0xe9, 0xc1, 0x50, 0xf4, 0x76, 0xa8, 0x0d, 0xfe, 0xd3, 0x55, 0x48, 0xda, 0xd7, 0x52,
+    0x28, 0x6e, 0x09, 0xd8, 0xeb, 0x5d, 0x8f, 0x01, 0xf6, 0x4c, 0xf4, 0x55, 0x10, 0x9b, 0x81, 0x6d,
+    0x19, 0x09, 0xca, 0xd1, 0x56, 0x46, 0x74, 0xde, 0x12, 0x74, 0x1d, 0x94, 0xd4, 0x31, 0xb2, 0x6c,
+    0x5f, 0x35, 0xc0, 0x2c, 0xe4, 0xd8, 0x16, 0x3f, 0x0a, 0x57, 0x35, 0x48, 0x58, 0xd4, 0xf7, 0x5c,
+    0x00, 0xee, 0x58, 0xdb, 0x49, 0x3c, 0x45, 0x6c, 0x7f, 0xe3, 0xa4, 0xf8, 0x89, 0xbe, 0xa7, 0x88,
+    0x1d, 0x50, 0x46, 0xf6, 0x22, 0xe2, 0x57, 0x19, 0xea, 0x8a, 0x0f, 0xba, 0x37, 0x40, 0x2f, 0x91,
+    0x27, 0x20, 0x84, 0x33, 0x25, 0x85, 0x06, 0x29, 0x2c, 0x45, 0x71, 0x23, 0x2c, 0xc4, 0xb7, 0x96,
+    0x22, 0x9c, 0x1e, 0x80, 0x40, 0x85, 0x47, 0x84, 0xbd, 0xee, 0xa1, 0x61, 0x5b, 0x8c, 0x69, 0x42,
+    0xc1, 0xcf, 0x4a, 0xbd, 0x7d, 0x72, 0x75, 0xe2, 0xf8, 0xdd, 0xfb, 0xfb, 0x7b, 0x4a, 0x78, 0x6b,
+    0xd9, 0x06, 0xa1, 0x34, 0xfa, 0x13, 0x9a, 0x67, 0xdc, 0xdf, 0x13, 0xa6, 0x50, 0x9e, 0x9c, 0xa0,
+    0x4d, 0x44, 0x02, 0xdb, 0xe8, 0x5e, 0x72, 0x50, 0xda, 0xf9, 0xfc, 0x1a, 0xa5, 0x26, 0x8a, 0x2b,
+    0xec, 0x5c, 0x60, 0x9b, 0x63, 0xd9, 0x6f, 0x36, 0xde, 0xa9, 0xae, 0x37, 0x94, 0xef, 0x68, 0x4f,
+    0x21, 0xbe, 0xfd, 0xc3, 0xb9, 0xdf, 0xe9, 0x99, 0xdf, 0xa2, 0x49, 0x8a, 0x9f, 0x6f, 0xaf, 0x4f,
+    0xa1, 0xff, 0x18, 0x6b, 0x54, 0xe1, 0x2f, 0xf0, 0xff, 0x53, 0xe6, 0x05, 0xcc, 0x50, 0x1e, 0x8b,
+    0x35, 0x7d, 0x4f, 0xf6, 0x38, 0x56, 0xda, 0x23, 0x7f, 0x23, 0xf6, 0x57, 0xbd, 0x2d, 0x4d, 0x76,
+    0x34, 0x8a, 0xe7, 0x44, 0x60, 0xdb, 0x97, 0xad, 0x20, 0xac, 0x2d, 0x93, 0x3d, 0x0d, 0xef, 0x7c,
+    0x9c, 0xd0, 0x8b, 0xb8, 0x5a, 0xad, 0x6f, 0x6f, 0xde, 0x8d, 0x88, 0x79, 0xe6, 0xaf, 0xe8, 0x0b,
+    0xc6, 0x43, 0x89, 0xc8, 0x63, 0xd6, 0x15, 0x93, 0x1a, 0x29, 0xb3, 0xa6, 0x49, 0x16, 0xf6, 0xdb,
+    0x64, 0x36, 0xa7, 0xb0, 0x53, 0xd3, 0x9a, 0x32, 0x3e, 0x04, 0xc8, 0xd4, 0xcc, 0xe0, 0xb3, 0x41,
+    0xd7, 0x1b, 0x05, 0x66, 0xfe, 0xd1, 0x6a, 0x35, 0x9d, 0x5d, 0x7d, 0x79, 0x66, 0x15, 0x77, 0xcf,
+    0x1e, 0xca, 0xbb, 0xf1, 0x53, 0x86, 0xee, 0x4b, 0xd1, 0x06, 0x87, 0x45, 0xae, 0xab, 0xbe, 0xa5,
+    0x18, 0x9e, 0x6f, 0xd0, 0xad, 0x24, 0xfa, 0xee, 0xeb, 0xfd, 0x35, 0x9f, 0x0a, 0x3e, 0x9b, 0x07,
+    0x1b, 0x58, 0x8e, 0xb6, 0xbf, 0x0a, 0xfe, 0x1b, 0x95, 0x3a, 0xaa, 0x9a, 0x54, 0xec, 0x46, 0x47,
+    0xf3, 0x6c, 0x2c, 0x73, 0x59, 0xfc, 0x69, 0xf3, 0x27, 0xdc, 0x1c, 0x6e, 0x7c, 0xf2, 0x08, 0x00,
+    0x00,
+};
+
+#endif
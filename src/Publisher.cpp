@@ -0,0 +1,168 @@
+/**
+ * @file Publisher.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief 
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <IoT3.h>
+#include <PubSubClient.h>
+
+/**
+ * State changes closer than this are sent as one message
+ */
+#define PUBLISH_WINDOW 20
+
+extern Scheduler scheduler;
+
+/**
+ * @brief Construct a new Publisher:: Publisher object
+ * 
+ * @param client 
+ */
+Publisher::Publisher(PubSubClient& client) :
+    client(client), pending(0), compose(nullptr), context(nullptr), last(0), timer(-1),
+    sent(0), bytes(0), coalesced(0), dropped(0) {}
+
+/**
+ * @brief Set the function writing the state message
+ * 
+ * @param compose called at most once per window, calls send()
+ * @param context passed back to compose
+ */
+void Publisher::setup(TaskCallback compose, void* context) {
+    this->compose = compose;
+    this->context = context;
+    last = millis() - PUBLISH_WINDOW;
+}
+
+/**
+ * @brief Notify a state change. The first change of a window is sent
+ *        at the end of the current scheduler pass, so that the changes
+ *        made by the same task go out together; the following ones are
+ *        merged into one message at the end of the window
+ */
+void Publisher::request() {
+    if (timer >= 0) {
+        coalesced++;
+        return;
+    }
+    unsigned long elapsed = millis() - last;
+    timer = scheduler.after(elapsed >= PUBLISH_WINDOW ? 0 : PUBLISH_WINDOW - elapsed, fire, this);
+    if (timer < 0) fire(this);
+}
+
+/**
+ * @brief Scheduler timer closing a window with pending changes
+ * 
+ * @param context the publisher
+ */
+void Publisher::fire(void* context) {
+    Publisher* publisher = (Publisher*)context;
+    publisher->timer = -1;
+    publisher->last = millis();
+    publisher->compose(publisher->context);
+}
+
+/**
+ * @brief Publish a message, or keep it for when the broker comes back.
+ *        A message replaces the one waiting on the same topic, since
+ *        only the latest state matters
+ * 
+ * @param topic must outlive the message
+ * @param payload 
+ * @param length at most MAX_MESSAGE
+ * @param retained 
+ * @return true if the message was sent now
+ */
+bool Publisher::send(const char* topic, const char* payload, size_t length, bool retained) {
+    if (length > MAX_MESSAGE) return false;
+    for (uint8_t i = 0; i < pending; i++) {
+        if (outbox[i].topic != topic && strcmp(outbox[i].topic, topic)) continue;
+        remove(i);
+        coalesced++;
+        break;
+    }
+
+    /**
+     * Older messages go first
+     */
+    flush();
+    if (!pending && client.publish(topic, (const uint8_t*)payload, length, retained)) {
+        sent++;
+        bytes += length;
+        return true;
+    }
+    if (pending == MAX_OUTBOX) {
+        remove(0);
+        dropped++;
+    }
+    Outgoing& outgoing = outbox[pending++];
+    outgoing.topic = topic;
+    outgoing.retained = retained;
+    outgoing.length = length;
+    memcpy(outgoing.payload, payload, length);
+    return false;
+}
+
+/**
+ * @brief Publish the waiting messages in order, as long as the broker
+ *        takes them; called again on each reconnection
+ */
+void Publisher::flush() {
+    while (pending) {
+        Outgoing& outgoing = outbox[0];
+        if (!client.publish(outgoing.topic, (const uint8_t*)outgoing.payload, outgoing.length, outgoing.retained)) return;
+        sent++;
+        bytes += outgoing.length;
+        remove(0);
+    }
+}
+
+/**
+ * @brief Remove a waiting message, keeping the order of the others
+ */
+void Publisher::remove(uint8_t index) {
+    for (uint8_t i = index; i + 1 < pending; i++) outbox[i] = outbox[i + 1];
+    pending--;
+}
+
+/**
+ * @brief Number of messages waiting for the broker
+ * 
+ * @return uint8_t 
+ */
+uint8_t Publisher::getPending() {return pending;}
+
+/**
+ * @brief Number of messages published since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long Publisher::getSent() {return sent;}
+
+/**
+ * @brief Payload bytes published since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long Publisher::getBytes() {return bytes;}
+
+/**
+ * @brief Number of state changes or messages merged into a later one
+ *        since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long Publisher::getCoalesced() {return coalesced;}
+
+/**
+ * @brief Number of messages lost because the outbox was full since boot
+ * 
+ * @return unsigned long 
+ */
+unsigned long Publisher::getDropped() {return dropped;}
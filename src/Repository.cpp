@@ -12,9 +12,49 @@
 
 #include <IoT3.h>
 #include <EEPROM.h>
+#include <spi_flash.h>
 
 /**
- * @brief Computes the offset of an attribute into the EEPROM
+ * The log uses the sector of the emulated EEPROM and the one before it.
+ * The firmware mounts no file system; on layouts without one, that
+ * sector is OTA space and an update overwriting it is recovered from
+ * like any torn sector.
+ */
+#ifndef STORAGE_SECTOR
+extern "C" uint32_t _EEPROM_start;
+#define STORAGE_SECTOR ((((uint32_t)&_EEPROM_start - 0x40200000) / SPI_FLASH_SEC_SIZE) - 1)
+#endif
+
+/**
+ * State record, one per channel
+ */
+struct StateRecord {
+    uint8_t mode;
+    uint8_t state;
+    uint8_t position;
+};
+
+/**
+ * Travel record, one per channel; 0 for a channel never calibrated
+ */
+struct TravelRecord {
+    uint16_t opening;
+    uint16_t closing;
+};
+
+/**
+ * Program variables
+ */
+DEVICE_STATE Storage storage(STORAGE_SECTOR);
+
+/**
+ * Process-wide copy of the repository
+ */
+DEVICE_STATE Repository Repository::cache;
+DEVICE_STATE bool Repository::loaded = false;
+
+/**
+ * @brief Computes the offset of an attribute into the record
  * 
  * @param field 
  * @return int 
@@ -26,106 +66,260 @@ int Repository::offset(void* field) {
 /**
  * @brief Construct a new Repository:: Repository object
  */
-Repository::Repository() {
+Repository::Repository() : ok(false), format(WF_JSON) {
+    clear();
+    photocell.night = 0;
+    photocell.day = 0;
+    photocell.dwell = 0;
 }
 
+/**
+ * @brief Get the process-wide copy of the repository; the flash is
+ *        read on first use and again only after a save()
+ * 
+ * @return const Repository& 
+ */
+const Repository& Repository::cached() {
+    if (!loaded) {
+        cache.load();
+        loaded = true;
+    }
+    return cache;
+}
+
+/**
+ * @brief Loads the newest configuration record, migrating the layout
+ *        of the first firmware (plain EEPROM) on the first boot
+ * 
+ * @return true if the repository was saved by the firmware
+ */
 bool Repository::load() {
+    if (storage.read(RT_CONFIG, this, sizeof(*this))) return ok;
+
+    /**
+     * Layout 0: all attributes at the start of the emulated EEPROM
+     */
     EEPROM.begin(sizeof(*this));
     EEPROM.get(offset(ssid), ssid);
     EEPROM.get(offset(password), password);
     EEPROM.get(offset(name), name);
     EEPROM.get(offset(mqttServer), mqttServer);
     EEPROM.get(offset(mqttPort), mqttPort);
-
-#ifdef FEATURE_1
-    EEPROM.get(offset(&state), state);
-    EEPROM.get(offset(&mode), mode);
-#endif
-
     EEPROM.get(offset(&ok), ok);
+    EEPROM.end();
+    if (*(uint8_t*)&ok != 1) {
+
+        /**
+         * Blank flash reads 0xff everywhere, unterminated strings
+         * included; nothing of it is kept
+         */
+        clear();
+        return ok = false;
+    }
+    save();
     return ok;
 }
 
+/**
+ * @brief Empties the strings of the configuration
+ */
+void Repository::clear() {
+    ssid[0] = 0;
+    password[0] = 0;
+    name[0] = 0;
+    mqttServer[0] = 0;
+    mqttPort[0] = 0;
+}
+
+/**
+ * @brief Determines whether the repository was saved by the firmware
+ * 
+ * @return true 
+ * @return false 
+ */
+bool Repository::isValid() const {return ok;}
+
 /**
  * @brief All getters
  */
-String Repository::getSSID() {return String(ssid);}
-String Repository::getPassword() {return String(password);}
-String Repository::getName() {return String(name);}
-String Repository::getMQTTServer() {return String(mqttServer);}
-String Repository::getMQTTPort() {return String(mqttPort);}
+const char* Repository::getSSID() const {return ssid;}
+const char* Repository::getPassword() const {return password;}
+const char* Repository::getName() const {return name;}
+const char* Repository::getMQTTServer() const {return mqttServer;}
+const char* Repository::getMQTTPort() const {return mqttPort;}
+WireFormat Repository::getFormat() const {return (WireFormat)format;}
+const PhotocellSettings& Repository::getPhotocell() const {return photocell;}
 
-#ifdef FEATURE_1
-blindsState Repository::getState() {
-    return state;
-}    
-blindsMode Repository::getMode() {
-    return mode;
+/**
+ * @brief Copy a value into a field, truncated to the field size
+ * 
+ * @param field 
+ * @param size of the field
+ * @param str 
+ */
+void Repository::copy(char* field, size_t size, const char* str) {
+    strncpy(field, str, size - 1);
+    field[size - 1] = 0;
 }
-#endif
 
 /**
  * @brief All setters
  */
-void Repository::setSSID(const String& str) {str.toCharArray(ssid, str.length() + 1);}
-void Repository::setPassword(const String& str) {str.toCharArray(password, str.length() + 1);}
-void Repository::setName(const String& str) {str.toCharArray(name, str.length() + 1);}
-void Repository::setMQTTServer(const String& str) {str.toCharArray(mqttServer, str.length() + 1);}
-void Repository::setMQTTPort(const String& str) {str.toCharArray(mqttPort, str.length() + 1);}
-
-#ifdef FEATURE_1
-void Repository::setState(const blindsState state) {
-    this->state = state;
-}    
-void Repository::setMode(const blindsMode mode) {
-    this->mode = mode;
-}
-#endif
+void Repository::setSSID(const char* str) {copy(ssid, sizeof(ssid), str);}
+void Repository::setPassword(const char* str) {copy(password, sizeof(password), str);}
+void Repository::setName(const char* str) {copy(name, sizeof(name), str);}
+void Repository::setMQTTServer(const char* str) {copy(mqttServer, sizeof(mqttServer), str);}
+void Repository::setMQTTPort(const char* str) {copy(mqttPort, sizeof(mqttPort), str);}
+void Repository::setFormat(WireFormat format) {this->format = format;}
+void Repository::setPhotocell(const PhotocellSettings& settings) {photocell = settings;}
 
 /**
- * @brief Saves all attributes into the EEPROM
+ * @brief Saves all attributes as a new configuration record
  */
 void Repository::save() {
-    EEPROM.begin(sizeof(*this));
-    EEPROM.put(offset(ssid), ssid);
-    EEPROM.put(offset(password), password);
-    EEPROM.put(offset(name), name);
-    EEPROM.put(offset(mqttServer), mqttServer);
-    EEPROM.put(offset(mqttPort), mqttPort);
-
-#ifdef FEATURE_1
-    EEPROM.put(offset(&state), state);
-    EEPROM.put(offset(&mode), mode);
-#endif
-
 #ifdef FORMAT_FIRMWARE 
 #ifdef WITH_DEFAULT
-    EEPROM.put(offset(&ok), true);
+    ok = true;
 #else
-    EEPROM.put(offset(&ok), false);
+    ok = false;
 #endif
 #else
-     EEPROM.put(offset(&ok), true);
+    ok = true;
 #endif
 
-    EEPROM.commit();
-    EEPROM.end();
+    storage.write(RT_CONFIG, this, sizeof(*this));
+
+    /**
+     * The cached copy is stale
+     */
+    loaded = false;
+}
+
+/**
+ * @brief Loads the mode, the resting state and the position of one
+ *        channel; records saved before positions were tracked read a
+ *        position of 0, and those saved before channels were added
+ *        only hold the first one
+ * 
+ * @param channel
+ * @param mode 
+ * @param state 
+ * @param position 
+ * @return false if they were never saved
+ */
+bool Repository::loadState(uint8_t channel, BlindsMode& mode, BlindsState& state, uint8_t& position) {
+    StateRecord records[CHANNELS];
+    if (channel >= CHANNELS || !storage.read(RT_STATE, records, sizeof(records))) return false;
+    mode = (BlindsMode)records[channel].mode;
+    state = (BlindsState)records[channel].state;
+    position = records[channel].position;
+    return true;
 }
 
-String Repository::toString() {
-    String string = 
-                "{\n";
-    string += "\t'SSID': '" + getSSID() + "',\n";
-    string += "\t'Password': '" + getPassword() + "',\n";
-    string += "\t'Name': '" + getName() + "',\n";
-    string += "\t'MQTT server': '" + getMQTTServer() + "',\n";
-    string += "\t'MQTT port': '" + getMQTTPort() + "',\n";
+/**
+ * @brief Saves the mode, the state and the position of one channel;
+ *        the channels share one record, cheap enough to be rewritten
+ *        on every transition
+ * 
+ * @param channel
+ * @param mode 
+ * @param state 
+ * @param position 
+ */
+void Repository::saveState(uint8_t channel, BlindsMode mode, BlindsState state, uint8_t position) {
+    StateRecord records[CHANNELS];
+    if (channel >= CHANNELS) return;
+    if (!storage.read(RT_STATE, records, sizeof(records))) memset(records, 0, sizeof(records));
+    StateRecord record = {(uint8_t)mode, (uint8_t)state, position};
+    records[channel] = record;
+    storage.write(RT_STATE, records, sizeof(records));
+}
 
-#ifdef FEATURE_1
-    string += "\t'Mode': '" + String(getMode()) + "',\n";
-    string += "\t'State': '" + String(getState()) + "'\n";
-#endif
+/**
+ * @brief Loads the travel times learned for one channel
+ *
+ * @param channel
+ * @param opening in ms
+ * @param closing in ms
+ * @return false if they were never saved
+ */
+bool Repository::loadTravel(uint8_t channel, uint16_t& opening, uint16_t& closing) {
+    TravelRecord records[CHANNELS];
+    if (channel >= CHANNELS || !storage.read(RT_TRAVEL, records, sizeof(records))) return false;
+    opening = records[channel].opening;
+    closing = records[channel].closing;
+    return opening && closing;
+}
 
+/**
+ * @brief Saves the travel times learned for one channel; they only
+ *        change on a calibration or once a refinement adds up
+ *
+ * @param channel
+ * @param opening in ms
+ * @param closing in ms
+ */
+void Repository::saveTravel(uint8_t channel, uint16_t opening, uint16_t closing) {
+    TravelRecord records[CHANNELS];
+    if (channel >= CHANNELS) return;
+    if (!storage.read(RT_TRAVEL, records, sizeof(records))) memset(records, 0, sizeof(records));
+    TravelRecord record = {opening, closing};
+    records[channel] = record;
+    storage.write(RT_TRAVEL, records, sizeof(records));
+}
+
+/**
+ * @brief Loads the location and the rules of the schedule
+ *
+ * @param settings
+ * @return false if no schedule was ever saved
+ */
+bool Repository::loadSchedule(ScheduleSettings& settings) {
+    return storage.read(RT_SCHEDULE, &settings, sizeof(settings));
+}
+
+/**
+ * @brief Saves the location and the rules of the schedule; they only
+ *        change when the controller sends them
+ *
+ * @param settings
+ */
+void Repository::saveSchedule(const ScheduleSettings& settings) {
+    storage.write(RT_SCHEDULE, &settings, sizeof(settings));
+}
+
+/**
+ * @brief Loads the groups the channels belong to
+ *
+ * @param settings
+ * @return false if no group was ever joined
+ */
+bool Repository::loadGroups(GroupSettings& settings) {
+    return storage.read(RT_GROUPS, &settings, sizeof(settings));
+}
+
+/**
+ * @brief Saves the groups the channels belong to
+ *
+ * @param settings
+ */
+void Repository::saveGroups(const GroupSettings& settings) {
+    storage.write(RT_GROUPS, &settings, sizeof(settings));
+}
+
+/**
+ * @brief Describes the repository without allocating
+ *
+ * @return FixedString<MAX_DESCRIPTION>
+ */
+FixedString<MAX_DESCRIPTION> Repository::toString() const {
+    FixedString<MAX_DESCRIPTION> string("{\n");
+    string.appendf("\t'SSID': '%s',\n", getSSID());
+    string.appendf("\t'Password': '%s',\n", *getPassword() ? "********" : "");
+    string.appendf("\t'Name': '%s',\n", getName());
+    string.appendf("\t'MQTT server': '%s',\n", getMQTTServer());
+    string.appendf("\t'MQTT port': '%s',\n", getMQTTPort());
+    string.appendf("\t'Format': %u,\n", format);
     string += "}\n\n";
     return string;
 }
@@ -0,0 +1,237 @@
+/**
+ * @file Schedule.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Rules of the week and sunrise and sunset of the location
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <math.h>
+
+/**
+ * Days between 1970-01-01 and 2000-01-01, and the time of the J2000
+ * epoch the solar equations count from
+ */
+#define J2000_DAY   10957
+#define J2000_TIME  946728000L
+#define DAY         86400L
+
+/**
+ * Altitude of the centre of the sun at sunrise and sunset, refraction
+ * and the radius of the disc included, and the tilt of the earth
+ */
+#define SUN_ALTITUDE -0.833
+#define OBLIQUITY    23.4397
+
+static double radians(double degrees) {return degrees * M_PI / 180;}
+
+/**
+ * @brief Construct a new Schedule:: Schedule object
+ */
+Schedule::Schedule() {
+    memset(&settings, 0, sizeof(settings));
+}
+
+/**
+ * @brief Replace the location and the rules
+ *
+ * @param settings
+ */
+void Schedule::set(const ScheduleSettings& settings) {this->settings = settings;}
+
+/**
+ * @brief Location and rules
+ *
+ * @return const ScheduleSettings&
+ */
+const ScheduleSettings& Schedule::get() const {return settings;}
+
+/**
+ * @brief Whether no rule is in use
+ *
+ * @return true if every rule is without days
+ */
+bool Schedule::empty() const {
+    for (uint8_t i = 0; i < MAX_RULES; i++) {
+        if (settings.rules[i].days) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Whether a rule in use moves a channel
+ *
+ * @param channel
+ * @return true if the channel follows the schedule
+ */
+bool Schedule::drives(uint8_t channel) const {
+    for (uint8_t i = 0; i < MAX_RULES; i++) {
+        if (settings.rules[i].days && (settings.rules[i].channels & (1 << channel))) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Whether a rule in use follows the sun
+ *
+ * @return true if sunrise and sunset are needed
+ */
+bool Schedule::solar() const {
+    for (uint8_t i = 0; i < MAX_RULES; i++) {
+        if (settings.rules[i].days && settings.rules[i].event != SE_TIME) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Position of the sun at a time: its transit across the meridian
+ *        of the location and its declination
+ *
+ * @param date days from J2000, UTC
+ * @param longitude in degrees, east positive
+ * @param transit days from J2000 of the transit nearest the date
+ * @param declination in radians
+ */
+static void ephemeris(double date, double longitude, double& transit, double& declination) {
+    double noon = floor(date + longitude / 360 + 0.5) - longitude / 360;
+    double anomaly = fmod(357.5291 + 0.98560028 * date, 360);
+    double m = radians(anomaly);
+    double centre = 1.9148 * sin(m) + 0.02 * sin(2 * m) + 0.0003 * sin(3 * m);
+    double ecliptic = radians(fmod(anomaly + centre + 180 + 102.9372, 360));
+    transit = noon + 0.0053 * sin(m) - 0.0069 * sin(2 * ecliptic);
+    declination = asin(sin(ecliptic) * sin(radians(OBLIQUITY)));
+}
+
+/**
+ * @brief Time the sun crosses the horizon around a transit, with the
+ *        declination at that time rather than at noon
+ *
+ * @param latitude in radians
+ * @param longitude in degrees, east positive
+ * @param noon mean solar noon, days from J2000
+ * @param rising sunrise, else sunset
+ * @param time days from J2000
+ * @return false if the sun stays above or below the horizon
+ */
+static bool horizon(double latitude, double longitude, double noon, bool rising, double& time) {
+    time = noon;
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        double transit, declination;
+        ephemeris(time, longitude, transit, declination);
+        double angle = (sin(radians(SUN_ALTITUDE)) - sin(latitude) * sin(declination)) / (cos(latitude) * cos(declination));
+        if (angle < -1 || angle > 1) return false;
+        double hour = acos(angle) / (2 * M_PI);
+        time = rising ? transit - hour : transit + hour;
+    }
+    return true;
+}
+
+/**
+ * @brief Sunrise and sunset of a day at the location, after the
+ *        equations of the NOAA simplified to a minute or two
+ *
+ * @param day local day, counted from 1970-01-01
+ * @param rise UTC time of sunrise
+ * @param set UTC time of sunset
+ * @return false when the sun does not rise or does not set that day
+ */
+bool Schedule::sun(long day, time_t& rise, time_t& set) const {
+    double latitude = radians(settings.latitude / 100.0);
+    double longitude = settings.longitude / 100.0;
+    double noon = day - J2000_DAY - longitude / 360, up, down;
+    if (!horizon(latitude, longitude, noon, true, up) || !horizon(latitude, longitude, noon, false, down)) return false;
+    rise = J2000_TIME + (time_t)floor(up * DAY + 0.5);
+    set = J2000_TIME + (time_t)floor(down * DAY + 0.5);
+    return true;
+}
+
+/**
+ * @brief When a rule falls on a local day
+ *
+ * @param rule
+ * @param day local day, counted from 1970-01-01
+ * @param sun whether the sun rises and sets that day
+ * @param rise UTC time of sunrise
+ * @param set UTC time of sunset
+ * @param time UTC time of the rule
+ * @return false if the rule does not fall on that day
+ */
+bool Schedule::at(const ScheduleRule& rule, long day, bool sun, time_t rise, time_t set, time_t& time) const {
+    if (!(rule.days & (1 << ((day + 4) % 7)))) return false;
+    switch (rule.event) {
+        case SE_TIME:
+            time = day * DAY - settings.offset * 60L + rule.minute * 60L;
+            return true;
+        case SE_SUNRISE:
+            time = rise + rule.minute * 60L;
+            return sun;
+        case SE_SUNSET:
+            time = set + rule.minute * 60L;
+            return sun;
+    }
+    return false;
+}
+
+/**
+ * @brief Time of the first rule after now. Local days from yesterday are
+ *        looked at, for the offsets of rules that reach into the next
+ *        day
+ *
+ * @param now UTC
+ * @return time_t 0 if no rule falls within a week
+ */
+time_t Schedule::next(time_t now) const {
+    long today = (now + settings.offset * 60L) / DAY;
+    bool sunny = solar();
+    time_t first = 0;
+    for (long day = today - 1; day <= today + 8; day++) {
+        time_t rise = 0, set = 0, time;
+        bool up = sunny && sun(day, rise, set);
+        for (uint8_t i = 0; i < MAX_RULES; i++) {
+            if (!settings.rules[i].days || !at(settings.rules[i], day, up, rise, set, time) || time <= now) continue;
+            if (!first || time < first) first = time;
+        }
+    }
+    return first;
+}
+
+/**
+ * @brief Position the last rule for a channel gave, up to now
+ *
+ * @param channel
+ * @param now UTC
+ * @return int 0 (closed) to 100 (opened), -1 if no rule fell within a
+ *         week
+ */
+int Schedule::position(uint8_t channel, time_t now) const {
+    long today = (now + settings.offset * 60L) / DAY;
+    bool sunny = solar();
+    time_t last = 0;
+    int position = -1;
+    for (long day = today - 7; day <= today + 1; day++) {
+        time_t rise = 0, set = 0, time;
+        bool up = sunny && sun(day, rise, set);
+        for (uint8_t i = 0; i < MAX_RULES; i++) {
+            const ScheduleRule& rule = settings.rules[i];
+            if (!rule.days || !(rule.channels & (1 << channel)) || !at(rule, day, up, rise, set, time) || time > now) continue;
+            if (position < 0 || time >= last) {
+                last = time;
+                position = rule.position;
+            }
+        }
+    }
+    return position;
+}
+
+/**
+ * @brief Whether the clock was set over SNTP; until then it counts from
+ *        the boot
+ *
+ * @param now
+ * @return true once the clock is past CLOCK_VALID
+ */
+bool Schedule::valid(time_t now) {return now >= CLOCK_VALID;}
@@ -0,0 +1,208 @@
+/**
+ * @file Scheduler.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <limits.h>
+
+/**
+ * @brief Construct a new Scheduler:: Scheduler object
+ */
+Scheduler::Scheduler() : pollPeriod(0) {
+    for (int i = 0; i < MAX_TASKS; i++) tasks[i].callback = nullptr;
+}
+
+/**
+ * @brief Determines whether a deadline is reached, wrap-around safe
+ *
+ * @param deadline
+ * @param now
+ * @return true
+ * @return false
+ */
+bool Scheduler::due(unsigned long deadline, unsigned long now) {
+    return (long)(now - deadline) >= 0;
+}
+
+/**
+ * @brief Rounds a time up to a multiple of the period, so that tasks
+ *        of commensurate periods fall due in the same pass
+ *
+ * @param time
+ * @param period
+ * @return unsigned long
+ */
+unsigned long Scheduler::align(unsigned long time, unsigned long period) {
+    return time + (period - time % period) % period;
+}
+
+/**
+ * @brief Registers a task in a free slot
+ *
+ * @return the task id, -1 if all slots are taken
+ */
+int Scheduler::add(unsigned long delay, unsigned long period, TaskCallback callback, void* context) {
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (tasks[i].callback == nullptr) {
+            tasks[i].callback = callback;
+            tasks[i].context = context;
+            tasks[i].deadline = period ? align(millis() + delay, period) : millis() + delay;
+            tasks[i].period = period;
+            tasks[i].poll = 0;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Run a task every period milliseconds, on the multiples of the
+ *        period
+ *
+ * @param period
+ * @param callback
+ * @param context passed back to the callback
+ * @return the task id
+ */
+int Scheduler::every(unsigned long period, TaskCallback callback, void* context) {
+    return add(0, period, callback, context);
+}
+
+/**
+ * @brief Run a task that only looks for work every period
+ *        milliseconds; while the chip saves power, it runs no more often
+ *        than the poll period
+ *
+ * @param period
+ * @param callback
+ * @param context passed back to the callback
+ * @return the task id
+ */
+int Scheduler::poll(unsigned long period, TaskCallback callback, void* context) {
+    int id = add(0, period > pollPeriod ? period : pollPeriod, callback, context);
+    if (id >= 0) tasks[id].poll = period;
+    return id;
+}
+
+/**
+ * @brief Run a task once after delay milliseconds
+ *
+ * @param delay
+ * @param callback
+ * @param context passed back to the callback
+ * @return the task id
+ */
+int Scheduler::after(unsigned long delay, TaskCallback callback, void* context) {
+    return add(delay, 0, callback, context);
+}
+
+/**
+ * @brief Remove a task; the id may be -1 or refer to a one-shot task
+ *        that already ran
+ *
+ * @param id
+ */
+void Scheduler::cancel(int id) {
+    if (id >= 0 && id < MAX_TASKS) tasks[id].callback = nullptr;
+}
+
+/**
+ * @brief Stretch the polls to a common period so that they wake the
+ *        chip together; 0 gives them back their own period
+ *
+ * @param period
+ */
+void Scheduler::setPollPeriod(unsigned long period) {
+    pollPeriod = period;
+    unsigned long now = millis();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (tasks[i].callback == nullptr || !tasks[i].poll) continue;
+        tasks[i].period = tasks[i].poll > period ? tasks[i].poll : period;
+        tasks[i].deadline = align(now, tasks[i].period);
+    }
+}
+
+/**
+ * @brief Determines the number of milliseconds until the next task is
+ *        due
+ *
+ * @return unsigned long
+ */
+unsigned long Scheduler::idle() {
+    unsigned long now = millis();
+    unsigned long wait = MAX_IDLE;
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (tasks[i].callback == nullptr) continue;
+        if (due(tasks[i].deadline, now)) return 0;
+        if (tasks[i].deadline - now < wait) wait = tasks[i].deadline - now;
+    }
+    return wait;
+}
+
+/**
+ * @brief Determines the number of milliseconds until the next one-shot
+ *        task is due; the periodic ones only poll and may run late
+ *
+ * @return unsigned long ULONG_MAX when no one-shot task is pending
+ */
+unsigned long Scheduler::quiet() {
+    unsigned long now = millis();
+    unsigned long wait = ULONG_MAX;
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (tasks[i].callback == nullptr || tasks[i].period) continue;
+        if (due(tasks[i].deadline, now)) return 0;
+        if (tasks[i].deadline - now < wait) wait = tasks[i].deadline - now;
+    }
+    return wait;
+}
+
+/**
+ * @brief Runs the due tasks earliest deadline first, then yields to
+ *        the WiFi stack until the next one is due
+ */
+void Scheduler::loop() {
+
+    /**
+     * The pass is timed up to the idle wait
+     */
+    {
+        METRIC_TIME(MT_LOOP);
+        for (;;) {
+            unsigned long now = millis();
+            int next = -1;
+            for (int i = 0; i < MAX_TASKS; i++) {
+                if (tasks[i].callback == nullptr || !due(tasks[i].deadline, now)) continue;
+                if (next < 0 || (long)(tasks[i].deadline - tasks[next].deadline) < 0) next = i;
+            }
+            if (next < 0) break;
+
+            /**
+             * Periodic tasks keep their phase; one-shot tasks free their
+             * slot before running so that the callback may schedule again
+             */
+            Task task = tasks[next];
+            if (task.period) {
+                tasks[next].deadline += task.period;
+                if (due(tasks[next].deadline, now)) tasks[next].deadline = align(now + 1, task.period);
+            } else {
+                tasks[next].callback = nullptr;
+            }
+            task.callback(task.context);
+        }
+    }
+
+    /**
+     * Required for MQTT: the WiFi stack runs while we wait. This is
+     * where the chip sleeps when the power mode allows it
+     */
+    unsigned long wait = idle();
+    if (wait) delay(wait);
+    else yield();
+}
@@ -10,129 +10,150 @@
  */
 
 #include <IoT3.h>
+#include <ArduinoJson.h>
+#include <Portal.h>
+
+/**
+ * Form defaults; every value may need escaping
+ */
+#define VALUES_SIZE JSON_OBJECT_SIZE(4)
+#define MAX_VALUES  (2 * (MAX_SSID + MAX_NAME + MAX_MQTT_SERVER + MAX_MQTT_PORT) + 64)
+
+/**
+ * Portal page caching; the ETag changes with the page only
+ */
+#define PORTAL_HEADERS "Cache-Control: no-cache\r\nETag: " PORTAL_ETAG "\r\n"
+
+/**
+ * Form fields and the repository setter each one goes to
+ */
+static const struct {
+    const char* name;
+    void (Repository::*set)(const char* str);
+} fields[] = {
+    {"ssid", &Repository::setSSID},
+    {"password", &Repository::setPassword},
+    {"name", &Repository::setName},
+    {"mqtt_server", &Repository::setMQTTServer},
+    {"mqtt_port", &Repository::setMQTTPort}
+};
 
 /**
  * Program variables
  */
-ESP8266WebServer SoftAccessPoint::server(80);
-
-void SoftAccessPoint::handleRoot() {
-    const String form = "<!DOCTYPE html>\
-    <html>\
-    <head>\
-    <style>\
-    body {\
-        font-family: 'Roboto', sans-serif;\
-    }\
-    .form-row {\
-        display: flex;\
-    }\
-    .flex-container > div {\
-        margin: 10px;\
-        padding: 20px;\
-    }\
-    label {\
-        width: 100%\
-    }\
-    article {\
-        background-color: white;\
-        width: 280px;\
-        padding: 50px;\
-        margin: auto;\
-        box-shadow: 0px -2px 20px 2px rgba(0, 0, 0, 0.4);\
-	}\
-	.inputs {\
-		border-radius: 7px;\
-		padding: 5px;\
-		margin: 2px;\
-	}\
-        </style>\
-    </head>\
-    <body>\
-	<article>\
-        <form method='post' enctype='application/x-www-form-urlencoded' action='/postform/'>\
-            <h1>Object Repository</h1>\
-            <h3>WiFi Credentials</h1>\
-            <p>Please, enter the SSID and the password that will be used to connect to the Internet</p>\
-            <div class='form-row'>\
-                <label for='ssid'>SSID:</label>\
-                <input class='inputs' type='text' id='ssid' name='ssid' value='VIDEOTRON6590'>\
-            </div>\
-            <div class='form-row'>\
-                <label for='password'>Password:</label>\
-                <input class='inputs' type='text' id='password' name='password' value='A9UAYAHH9947N'>\
-            </div>\
-            <h3>Blinds identification</h1>\
-            <p>Enter a small description of the object such as <em>Kitchen</em> for example</p>\
-            <div class='form-row'>\
-                <label for='name'>Name:</label>\
-                <input class='inputs' type='text' id='name' name='name' value='Kitchen'>\
-            </div>\
-            <p>Your router will also list this device using the name you have entered above</p>\
-            <h3>MQTT message broker</h1>\
-            <p>The information above should not be changed except for debugging purposes</p>\
-            <div class='form-row'>\
-                <label for='mqtt_server'>URI:</label>\
-                <input class='inputs' type='text' id='mqtt_server' name='mqtt_server' value='test.mosquitto.org'>\
-            </div>\
-            <div class='form-row'>\
-                <label for='mqtt_port'>Port:</label>\
-                <input class='inputs' type='text' id='mqtt_port' name='mqtt_port' value='1883'>\
-            </div>\
-            <br/>\
-            <input type='submit' value='Save to EEPROM'>\
-        </form>\
-	</article>\
-    </body>\
-    </html>";
-    Serial.println(form);
-    server.send(200, "text/html", form);
+HttpServer SoftAccessPoint::server(80);
+Repository SoftAccessPoint::form;
+
+/**
+ * @brief Sends the portal page straight from flash. The page is the
+ *        same for every device of a firmware build, so the browser
+ *        only revalidates it against the ETag; the current values come
+ *        from /values
+ */
+void SoftAccessPoint::handleRoot(HttpSession& session) {
+    if (!strcmp(session.etag, PORTAL_ETAG)) {
+        server.send(session, 304, nullptr, "", PORTAL_HEADERS);
+        return;
+    }
+    server.send_P(session, 200, "text/html", PORTAL_GZ, sizeof(PORTAL_GZ),
+        PORTAL_HEADERS "Content-Encoding: gzip\r\n");
+}
+
+/**
+ * @brief Sends the current repository values used as form defaults.
+ *        The password is never sent back
+ */
+void SoftAccessPoint::handleValues(HttpSession& session) {
+    const Repository& repos = Repository::cached();
+    StaticJsonDocument<VALUES_SIZE> values;
+    values["ssid"] = repos.getSSID();
+    values["name"] = repos.getName();
+    values["mqtt_server"] = repos.getMQTTServer();
+    values["mqtt_port"] = repos.getMQTTPort();
+    char json[MAX_VALUES];
+    serializeJson(values, json, sizeof(json));
+    server.send(session, 200, "application/json", json, "Cache-Control: no-store\r\n");
+}
+
+/**
+ * @brief Writes a form field into the repository being edited as soon
+ *        as it is decoded; the server parses one form at a time
+ */
+void SoftAccessPoint::handleField(HttpSession& session, const char* name, const char* value) {
+    if (!session.fields) form = Repository::cached();
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (strcmp(fields[i].name, name)) continue;
+
+        /**
+         * The form does not show the password; empty keeps the current
+         * one, when there is a configuration to keep it from
+         */
+        if (fields[i].set == &Repository::setPassword && !*value && form.isValid()) return;
+        (form.*fields[i].set)(value);
+    }
 }
 
-void SoftAccessPoint::handleForm() {
-    if (server.method() != HTTP_POST) {
+void SoftAccessPoint::handleForm(HttpSession& session) {
+    if (session.method != HM_POST) {
 
         /**
          * Only HTTP_POST is allowed
          */
-        server.send(405, "text/plain", "Method Not Allowed");
+        server.send(session, 405, "text/plain", "Method Not Allowed");
 
+    } else if (!session.fields) {
+        server.send(session, 400, "text/plain", "Empty form");
     } else {
 
         /**
          * Save WiFi credentials
          */
-        Repository repos;
-        repos.setSSID(server.arg("ssid"));
-        repos.setPassword(server.arg("password"));
-        repos.setName(server.arg("name"));
-        repos.setMQTTServer(server.arg("mqtt_server"));
-        repos.setMQTTPort(server.arg("mqtt_port"));
-        repos.save();
+        form.save();
 
         /**
          * Send success message to user
          */
-        String resp = "Object configuration successfully saved. Please, reset to continue\n";
-        resp += repos.toString();
-        server.send(200, "text/plain", resp);
+        char resp[MAX_HTTP_RESPONSE / 2];
+        snprintf(resp, sizeof(resp), "Object configuration successfully saved. Please, reset to continue\n%s",
+            form.toString().c_str());
+        server.send(session, 200, "text/plain", resp);
     }
 }
 
-void SoftAccessPoint::handleNotFound() {
-    String resp = "File Not Found\n\n";
-    resp += "URI: ";
-    resp += server.uri();
-    resp += "\nMethod: ";
-    resp += (server.method() == HTTP_GET) ? "GET" : "POST";
-    resp += "\nArguments: ";
-    resp += server.args();
-    resp += "\n";
-    for (uint8_t i = 0; i < server.args(); i++) {
-        resp += " " + server.argName(i) + ": " + server.arg(i) + "\n";
-    }
-    server.send(404, "text/plain", resp);
+void SoftAccessPoint::handleNotFound(HttpSession& session) {
+    char resp[MAX_HTTP_URI + 48];
+    snprintf(resp, sizeof(resp), "File Not Found\n\nURI: %s\nMethod: %s\n",
+        session.uri, session.method == HM_GET ? "GET" : session.method == HM_POST ? "POST" : "OTHER");
+    server.send(session, 404, "text/plain", resp);
+}
+
+#if METRICS
+/**
+ * @brief Sends the diagnostics of the running firmware
+ */
+void SoftAccessPoint::handleMetrics(HttpSession& session) {
+    char json[MAX_DIAGNOSTICS];
+    if (BlindsStub::diagnostics(json, sizeof(json))) server.send(session, 200, "application/json", json, "Cache-Control: no-store\r\n");
+    else server.send(session, 500, "text/plain", "Metrics do not fit");
+}
+
+/**
+ * @brief Serves /metrics alone while the blinds firmware runs; the
+ *        server of the portal is otherwise idle then
+ */
+void SoftAccessPoint::startMetrics() {
+    server.on("/metrics", handleMetrics);
+    server.onNotFound(handleNotFound);
+    server.begin();
+}
+
+/**
+ * @brief Serves the pending requests; called from the blinds firmware
+ */
+void SoftAccessPoint::serve() {
+    server.loop();
 }
+#endif
 
 SoftAccessPoint::SoftAccessPoint() {}
 
@@ -149,12 +170,13 @@ void SoftAccessPoint::setup() {
     WiFi.softAP(DEF_APSSID, DEF_APPSK);
     IPAddress myIP = WiFi.softAPIP();
     server.on("/", handleRoot);
-    server.on("/postform/", handleForm);
+    server.on("/values", handleValues);
+    server.on("/postform/", handleForm, handleField);
     server.onNotFound(handleNotFound);
     server.begin();
     Serial.println("Soft access point started");
 }
 
 void SoftAccessPoint::loop() {
-    server.handleClient();
+    server.loop();
 }
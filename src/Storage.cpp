@@ -0,0 +1,277 @@
+/**
+ * @file Storage.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+#include <spi_flash.h>
+
+/**
+ * Record layout
+ */
+#define STORAGE_MAGIC   0xB11D
+#define STORAGE_VERSION 1
+#define ERASED          0xFFFFFFFF
+
+/**
+ * @brief Header written in front of every record; the CRC covers the
+ *        header up to the CRC itself and the payload
+ */
+struct RecordHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint32_t sequence;
+    uint16_t length;
+    uint16_t reserved;
+    uint32_t crc;
+};
+
+/**
+ * @brief Records take a whole number of flash words
+ *
+ * @param length of the payload
+ * @return uint32_t
+ */
+static uint32_t footprint(uint16_t length) {
+    return sizeof(RecordHeader) + ((length + 3) & ~3);
+}
+
+/**
+ * @brief CRC-32 (IEEE)
+ *
+ * @param crc previous value, 0 to start
+ * @param data
+ * @param length
+ * @return uint32_t
+ */
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Construct a new Storage:: Storage object
+ *
+ * @param sector first of the two flash sectors used by the log
+ */
+Storage::Storage(uint32_t sector) :
+    first(sector), mounted(false), active(0), offset(0), sequence(0), erases(0) {
+    memset(live, 0, sizeof(live));
+}
+
+/**
+ * @brief Flash address of an offset into one of the two sectors
+ */
+uint32_t Storage::address(uint8_t sector, uint32_t offset) {
+    return (first + sector) * SPI_FLASH_SEC_SIZE + offset;
+}
+
+/**
+ * @brief Validates the record at an offset of a sector
+ *
+ * @param sector
+ * @param offset
+ * @param header read from the flash
+ * @return true if the record is complete and its CRC matches
+ */
+bool Storage::check(uint8_t sector, uint32_t offset, RecordHeader& header) {
+    if (offset + sizeof(header) > SPI_FLASH_SEC_SIZE) return false;
+    ESP.flashRead(address(sector, offset), (uint32_t*)&header, sizeof(header));
+    if (header.magic != STORAGE_MAGIC || header.version != STORAGE_VERSION) return false;
+    if (header.type == 0 || header.type > RECORD_TYPES) return false;
+    if (header.length > MAX_RECORD || offset + footprint(header.length) > SPI_FLASH_SEC_SIZE) return false;
+
+    /**
+     * The payload is checked by chunks to keep the stack small
+     */
+    uint32_t crc = crc32(0, (const uint8_t*)&header, offsetof(RecordHeader, crc));
+    uint32_t chunk[16];
+    uint32_t done = 0;
+    while (done < header.length) {
+        uint32_t size = header.length - done < sizeof(chunk) ? header.length - done : sizeof(chunk);
+        ESP.flashRead(address(sector, offset + sizeof(header) + done), chunk, (size + 3) & ~3);
+        crc = crc32(crc, (const uint8_t*)chunk, size);
+        done += size;
+    }
+    return crc == header.crc;
+}
+
+/**
+ * @brief Walks the records of a sector up to the first invalid one
+ *
+ * @param sector
+ * @param scan summary of the sector
+ */
+void Storage::scan(uint8_t sector, Scan& scan) {
+    RecordHeader header;
+    memset(&scan, 0, sizeof(scan));
+    uint32_t offset = 0;
+    while (check(sector, offset, header)) {
+        if (header.type == RT_COMMIT) {
+            scan.committed = true;
+            scan.commit = header.sequence;
+        }
+        if (header.sequence > scan.last) scan.last = header.sequence;
+        offset += footprint(header.length);
+    }
+    scan.end = offset;
+
+    /**
+     * Whatever follows the last record must still be erased, otherwise
+     * a write was cut and the tail cannot be appended to
+     */
+    uint32_t word = ERASED;
+    if (offset < SPI_FLASH_SEC_SIZE) ESP.flashRead(address(sector, offset), &word, sizeof(word));
+    scan.torn = word != ERASED;
+}
+
+/**
+ * @brief Boot time recovery: the active sector is the committed one
+ *        with the newest commit, and the live records are the newest
+ *        of each type in it
+ */
+void Storage::mount() {
+    Scan scans[2];
+    scan(0, scans[0]);
+    scan(1, scans[1]);
+    sequence = scans[0].last > scans[1].last ? scans[0].last : scans[1].last;
+    memset(live, 0, sizeof(live));
+    mounted = true;
+
+    int sector = -1;
+    for (int i = 0; i < 2; i++) {
+        if (scans[i].committed && (sector < 0 || scans[i].commit > scans[sector].commit)) sector = i;
+    }
+    if (sector < 0) {
+
+        /**
+         * Blank or foreign flash; the first write formats it
+         */
+        active = 1;
+        offset = SPI_FLASH_SEC_SIZE;
+        return;
+    }
+    active = sector;
+    offset = scans[sector].torn ? SPI_FLASH_SEC_SIZE : scans[sector].end;
+
+    RecordHeader header;
+    uint32_t at = 0;
+    while (at < scans[sector].end && check(active, at, header)) {
+        if (header.type != RT_COMMIT && header.sequence >= live[header.type - 1].sequence) {
+            live[header.type - 1].offset = at;
+            live[header.type - 1].length = header.length;
+            live[header.type - 1].sequence = header.sequence;
+        }
+        at += footprint(header.length);
+    }
+}
+
+/**
+ * @brief Writes one record at the append offset of the active sector
+ *
+ * @return false if the flash refused the write
+ */
+bool Storage::append(RecordType type, const void* data, uint16_t length) {
+    uint32_t buffer[(sizeof(RecordHeader) + MAX_RECORD + 3) / 4];
+    RecordHeader* header = (RecordHeader*)buffer;
+    uint32_t size = footprint(length);
+    memset(buffer, 0xff, size);
+    header->magic = STORAGE_MAGIC;
+    header->version = STORAGE_VERSION;
+    header->type = type;
+    header->sequence = ++sequence;
+    header->length = length;
+    header->reserved = 0xffff;
+    if (length) memcpy(header + 1, data, length);
+    header->crc = crc32(crc32(0, (const uint8_t*)header, offsetof(RecordHeader, crc)), (const uint8_t*)data, length);
+    if (!ESP.flashWrite(address(active, offset), buffer, size)) return false;
+    if (type != RT_COMMIT) {
+        live[type - 1].offset = offset;
+        live[type - 1].length = length;
+        live[type - 1].sequence = sequence;
+    }
+    offset += size;
+    return true;
+}
+
+/**
+ * @brief Copies the live records into the other sector and commits it.
+ *        The old sector stays intact until the next compaction, so a
+ *        power cut at any point leaves one committed sector holding
+ *        every live record.
+ *
+ * @return false if the flash refused an erase or a write
+ */
+bool Storage::compact() {
+    uint8_t source = active;
+    uint8_t target = active ^ 1;
+    Live copies[RECORD_TYPES];
+    memcpy(copies, live, sizeof(copies));
+    if (!ESP.flashEraseSector(first + target)) return false;
+    erases++;
+    active = target;
+    offset = 0;
+    for (int i = 0; i < RECORD_TYPES; i++) {
+        if (copies[i].sequence == 0) continue;
+        uint32_t buffer[(MAX_RECORD + 3) / 4];
+        ESP.flashRead(address(source, copies[i].offset + sizeof(RecordHeader)), buffer, (copies[i].length + 3) & ~3);
+        if (!append((RecordType)(i + 1), buffer, copies[i].length)) return false;
+    }
+    return append(RT_COMMIT, nullptr, 0);
+}
+
+/**
+ * @brief Reads the newest record of a type
+ *
+ * @param type
+ * @param data
+ * @param size of data; a shorter record is zero padded
+ * @return false if there is no such record
+ */
+bool Storage::read(RecordType type, void* data, size_t size) {
+    if (!mounted) mount();
+    const Live& record = live[type - 1];
+    if (record.sequence == 0) return false;
+    uint32_t buffer[(MAX_RECORD + 3) / 4];
+    ESP.flashRead(address(active, record.offset + sizeof(RecordHeader)), buffer, (record.length + 3) & ~3);
+    memset(data, 0, size);
+    memcpy(data, buffer, record.length < size ? record.length : size);
+    return true;
+}
+
+/**
+ * @brief Appends a new version of a record, compacting first when the
+ *        active sector is full or its tail was torn by a power cut
+ *
+ * @param type
+ * @param data
+ * @param size at most MAX_RECORD
+ * @return false if the record could not be written
+ */
+bool Storage::write(RecordType type, const void* data, size_t size) {
+    if (size > MAX_RECORD) return false;
+    if (!mounted) mount();
+    if (offset + footprint(size) > SPI_FLASH_SEC_SIZE) {
+        if (!compact()) return false;
+        if (offset + footprint(size) > SPI_FLASH_SEC_SIZE) return false;
+    }
+    return append(type, data, size);
+}
+
+/**
+ * @brief Number of sector erases since boot
+ *
+ * @return unsigned long
+ */
+unsigned long Storage::getErases() {return erases;}
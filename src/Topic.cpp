@@ -0,0 +1,72 @@
+/**
+ * @file Topic.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief 
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <IoT3.h>
+
+/**
+ * @brief Construct a new Topic:: Topic object
+ */
+Topic::Topic() : length(0) {
+    name[0] = 0;
+}
+
+/**
+ * @brief Build the topic name once so that incoming messages can be
+ *        matched without allocating
+ * 
+ * @param base such as TOPIC_COMMANDS
+ * @param suffix appended after a '/', if any
+ */
+void Topic::set(const char* base, const char* suffix) {
+    int n = suffix ? 
+        snprintf(name, sizeof(name), "%s/%s", base, suffix) : 
+        snprintf(name, sizeof(name), "%s", base);
+    length = n < (int)sizeof(name) ? n : sizeof(name) - 1;
+}
+
+/**
+ * @brief Get the topic name
+ * 
+ * @return const char* 
+ */
+const char* Topic::c_str() const {return name;}
+
+/**
+ * @brief Determines whether a received topic is this one; lengths are
+ *        compared first since most topics differ there
+ * 
+ * @param topic 
+ * @param length of the received topic
+ * @return true 
+ * @return false 
+ */
+bool Topic::matches(const char* topic, size_t length) const {
+    return length == this->length && memcmp(topic, name, length) == 0;
+}
+
+/**
+ * @brief Determines whether a received topic is a numbered subtopic of
+ *        this one, such as the topic of a channel
+ * 
+ * @param topic 
+ * @param length of the received topic
+ * @return int the number, -1 if the topic is not a numbered subtopic
+ */
+int Topic::child(const char* topic, size_t length) const {
+    if (length <= (size_t)this->length + 1 || length > (size_t)this->length + 4) return -1;
+    if (memcmp(topic, name, this->length) || topic[this->length] != '/') return -1;
+    int number = 0;
+    for (size_t i = this->length + 1; i < length; i++) {
+        if (topic[i] < '0' || topic[i] > '9') return -1;
+        number = number * 10 + topic[i] - '0';
+    }
+    return number;
+}
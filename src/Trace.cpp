@@ -0,0 +1,98 @@
+/**
+ * @file Trace.cpp
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Binary trace of the transitions of the blinds
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include <IoT3.h>
+
+/**
+ * Version of the dump format
+ */
+#define TRACE_VERSION 1
+
+static_assert(sizeof(TraceEntry) == TRACE_ENTRY, "the dump format has 12-byte entries");
+
+/**
+ * Program variables
+ */
+DEVICE_STATE TraceEntry Trace::ring[TRACE_ENTRIES];
+DEVICE_STATE uint16_t Trace::head = 0;
+DEVICE_STATE uint16_t Trace::count = 0;
+DEVICE_STATE uint16_t Trace::last[CHANNELS];
+
+/**
+ * @brief Adds a transition to the ring, overwriting the oldest one
+ *        when it is full
+ *
+ * @param channel
+ * @param source what sent the event
+ * @param event BlindsEvent, TE_SET_MODE or TE_SET_POSITION
+ * @param from state before the event
+ * @param to state after the event
+ * @param mode
+ * @param position in %
+ * @param flags TF_IGNORED
+ */
+void Trace::record(uint8_t channel, TraceSource source, uint8_t event,
+    uint8_t from, uint8_t to, uint8_t mode, uint8_t position, uint8_t flags) {
+    uint8_t tag = channel | source << 4;
+
+    /**
+     * The photocell sends the same event to every channel four times a
+     * second; an ignored event only moves the position of its previous
+     * occurrence
+     */
+    if (count) {
+        TraceEntry& previous = ring[last[channel]];
+        if (previous.channel == tag && previous.event == event && previous.from == from && previous.to == to &&
+            previous.mode == mode && previous.flags == flags && previous.repeat < 0xff &&
+            (previous.position == position || (flags & TF_IGNORED))) {
+            previous.position = position;
+            previous.repeat++;
+            return;
+        }
+    }
+    TraceEntry& entry = ring[head];
+    entry.time = millis();
+    entry.channel = tag;
+    entry.event = event;
+    entry.from = from;
+    entry.to = to;
+    entry.mode = mode;
+    entry.position = position;
+    entry.flags = flags;
+    entry.repeat = 0;
+    last[channel] = head;
+    head = (head + 1) % TRACE_ENTRIES;
+    if (count < TRACE_ENTRIES) count++;
+}
+
+/**
+ * @brief Writes the trace: version, entry size, entry count and uptime
+ *        in ms, then the entries oldest first, all little-endian
+ *
+ * @param buffer
+ * @param size of the buffer, MAX_TRACE at most
+ * @return size_t length written, 0 if the buffer is too small
+ */
+size_t Trace::dump(uint8_t* buffer, size_t size) {
+    size_t length = TRACE_HEADER + count * TRACE_ENTRY;
+    if (length > size) return 0;
+    uint32_t now = millis();
+    buffer[0] = TRACE_VERSION;
+    buffer[1] = TRACE_ENTRY;
+    buffer[2] = count & 0xff;
+    buffer[3] = count >> 8;
+    for (uint8_t i = 0; i < 4; i++) buffer[4 + i] = now >> (8 * i);
+    uint16_t first = (head + TRACE_ENTRIES - count) % TRACE_ENTRIES;
+    for (uint16_t i = 0; i < count; i++) {
+        memcpy(buffer + TRACE_HEADER + i * TRACE_ENTRY, &ring[(first + i) % TRACE_ENTRIES], TRACE_ENTRY);
+    }
+    return length;
+}
@@ -16,18 +16,23 @@
 /**
  * Blinds firmware 
  */
+DEVICE_STATE Scheduler scheduler;
 SoftAccessPoint softAccessPoint;
 BlindsStub blindsStub;
-Blinds blinds(blindsStub);
-Firmware* firmware = nullptr;
+DEVICE_STATE Blinds blinds(blindsStub);
+DEVICE_STATE bool configured = false;
 
+/**
+ * The firmware is chosen once at boot; the loop only branches on it
+ */
 void setup() {
-    Repository repos;
-    firmware = repos.load() ? (Firmware*)&blindsStub : (Firmware*)&softAccessPoint;
-    firmware->setup();
+    configured = Repository::cached().isValid();
+    if (configured) blindsStub.setup();
+    else softAccessPoint.setup();
 }
 void loop() {
-    firmware->loop();
+    if (configured) blindsStub.loop();
+    else softAccessPoint.loop();
 }
 #else
 
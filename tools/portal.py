@@ -0,0 +1,65 @@
+"""
+Compresses web/portal.html into src/Portal.h
+
+The page is served as is from flash with Content-Encoding: gzip; its
+ETag is derived from the compressed bytes so that browsers revalidate
+it after a firmware update only.
+
+Runs before every PlatformIO build (extra_scripts) or by hand:
+    python tools/portal.py
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")
+    root = env.subst("$PROJECT_DIR")
+except NameError:
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+source = os.path.join(root, "web", "portal.html")
+target = os.path.join(root, "src", "Portal.h")
+
+with open(source, "rb") as f:
+    blob = gzip.compress(f.read(), compresslevel=9, mtime=0)
+etag = hashlib.sha1(blob).hexdigest()[:16]
+
+lines = []
+for i in range(0, len(blob), 16):
+    lines.append("    " + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",")
+
+header = """#ifndef PORTAL_H
+#define PORTAL_H
+
+/**
+ * @file Portal.h
+ * @author Francois Rochefort (francoisrochefort@hotmail.fr)
+ * @brief Configuration portal page, gzip compressed
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ * Generated from web/portal.html by tools/portal.py; do not edit
+ */
+
+#include <Arduino.h>
+
+#define PORTAL_ETAG "\\"%s\\""
+
+static const uint8_t PORTAL_GZ[] PROGMEM = {
+%s
+};
+
+#endif
+""" % (etag, "\n".join(lines))
+
+old = None
+if os.path.exists(target):
+    with open(target) as f:
+        old = f.read()
+if old != header:
+    with open(target, "w") as f:
+        f.write(header)
@@ -0,0 +1,44 @@
+"""
+Decodes a trace dumped by a device
+
+Ask the device for its trace and save the reply, then decode it:
+    mosquitto_sub -h <broker> -t /IOT3/TRACE/<ip> -C 1 > trace.bin &
+    mosquitto_pub -h <broker> -t /IOT3/COMMANDS/<ip> -m '{"cmd":"dump_trace"}'
+    python tools/trace.py trace.bin
+
+The format is written by Trace::dump() in src/Trace.cpp: a header
+(version, entry size, entry count, uptime in ms) followed by the
+entries oldest first, all little-endian.
+"""
+
+import struct
+import sys
+
+HEADER = struct.Struct("<BBHI")
+ENTRY = struct.Struct("<IBBBBBBBB")
+
+EVENTS = {1: "open", 2: "close", 3: "timeout", 4: "daytime", 5: "nighttime", 6: "stop", 7: "end_stop",
+          16: "set_mode", 17: "set_position", 18: "calibrate", 19: "schedule"}
+SOURCES = {1: "mqtt", 2: "photocell", 3: "timeout", 4: "end_stop", 5: "schedule"}
+STATES = {1: "opening", 2: "opened", 3: "closing", 4: "closed"}
+MODES = {1: "manual", 2: "automatic"}
+IGNORED = 0x01
+
+
+def decode(blob):
+    version, size, count, uptime = HEADER.unpack_from(blob, 0)
+    if version != 1 or size != ENTRY.size:
+        raise ValueError("unknown trace format %d with %d-byte entries" % (version, size))
+    lines = ["uptime %.3f s, %d entries" % (uptime / 1000.0, count)]
+    for i in range(count):
+        time, tag, event, old, new, mode, position, flags, repeat = ENTRY.unpack_from(blob, HEADER.size + i * size)
+        lines.append("%10.3f s  ch%d  %-9s  %-12s  %-7s -> %-7s  %-9s %3d%%%s%s" % (
+            time / 1000.0, tag & 0x0f, SOURCES.get(tag >> 4, "?"), EVENTS.get(event, str(event)),
+            STATES.get(old, "?"), STATES.get(new, "?"), MODES.get(mode, "?"), position,
+            "  ignored" if flags & IGNORED else "", "  x%d" % (repeat + 1) if repeat else ""))
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    with open(sys.argv[1], "rb") if len(sys.argv) > 1 else sys.stdin.buffer as f:
+        print(decode(f.read()))